@@ -8,8 +8,10 @@ ROM_DIR=${ROM_DIR/Emus/Roms}
 EMU_NAME=${ROM_DIR/\/mnt\/SDCARD\/Roms\//}
 ROM=${1}
 
-needs-swap
+needs-swap "$ROM"
 
 HOME="$ROM_DIR"
 cd "$HOME"
-"$EMU_DIR/$EMU_EXE" "$ROM" &> "/mnt/SDCARD/.minui/logs/$EMU_NAME.txt"
+[ -f /tmp/timeline.txt ] && timeline mark exec "$EMU_NAME"
+"$EMU_DIR/$EMU_EXE" "$ROM" 2>&1 | logring "$EMU_NAME"
+[ -f /tmp/timeline.txt ] && timeline mark exit "$EMU_NAME"
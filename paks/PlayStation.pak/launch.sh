@@ -10,4 +10,6 @@ ROM=${1}
 
 HOME="$ROM_DIR"
 cd "$EMU_DIR"
-"$EMU_DIR/$EMU_EXE" -cdfile "$ROM" &> "/mnt/SDCARD/.minui/logs/$EMU_NAME.txt"
\ No newline at end of file
+[ -f /tmp/timeline.txt ] && timeline mark exec "$EMU_NAME"
+"$EMU_DIR/$EMU_EXE" -cdfile "$ROM" 2>&1 | logring "$EMU_NAME"
+[ -f /tmp/timeline.txt ] && timeline mark exit "$EMU_NAME"
\ No newline at end of file
@@ -4,4 +4,4 @@
 DIR=$(dirname "$0")
 cd "$DIR"
 
-flipbook "/mnt/SDCARD/.minui/screenshots" &> "/mnt/SDCARD/.minui/logs/Flipbook.txt"
\ No newline at end of file
+flipbook "/mnt/SDCARD/.minui/screenshots" 2>&1 | logring Flipbook
\ No newline at end of file
@@ -5,4 +5,4 @@
 rm -f /tmp/minui_exec
 rm -f /tmp/last.txt
 sync
-} &> "/mnt/SDCARD/.minui/logs/Stock UI.txt"
\ No newline at end of file
+} 2>&1 | logring "Stock UI"
\ No newline at end of file
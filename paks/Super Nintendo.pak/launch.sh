@@ -10,4 +10,6 @@ ROM=${1}
 
 HOME="$ROM_DIR"
 cd "$HOME"
-"$EMU_DIR/$EMU_EXE" "$ROM" &> "/mnt/SDCARD/.minui/logs/$EMU_NAME.txt"
+[ -f /tmp/timeline.txt ] && timeline mark exec "$EMU_NAME"
+"$EMU_DIR/$EMU_EXE" "$ROM" 2>&1 | logring "$EMU_NAME"
+[ -f /tmp/timeline.txt ] && timeline mark exit "$EMU_NAME"
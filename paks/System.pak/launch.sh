@@ -36,6 +36,13 @@ if [ "$a" == "" ]; then
 fi
 
 touch /tmp/minui_exec
+
+# launch timeline tracing, summarize with `timeline summary`
+rm -f /tmp/timeline.txt
+if [ -f "$SD/.minui/enable-timeline" ]; then
+	touch /tmp/timeline.txt
+fi
+
 sync
 
 while [ -f /tmp/minui_exec ]; do
@@ -43,20 +50,28 @@ while [ -f /tmp/minui_exec ]; do
 	mkdir -p "$SD/.minui/logs"
 	mkdir -p "$SD/.minui/screenshots"
 	
-	./MinUI &> "$SD/.minui/logs/MinUI.txt"
-	sync
+	# output collects in a ring in /tmp and reaches the SD card once, when MinUI exits
+	./MinUI 2>&1 | logring MinUI
+	[ -f /tmp/timeline.txt ] && timeline mark minui_exited
+	# no sync, MinUI commits its state store with its own fdatasync and next.sh is in tmpfs
 
-	NEXT="$SD/.minui/next.sh"
+	NEXT="/tmp/next.sh"
 	if [ -f $NEXT ]; then
 		CMD=`cat $NEXT`
 		rm -f $NEXT
+		[ -f /tmp/timeline.txt ] && timeline mark eval
 		eval $CMD
+		[ -f /tmp/timeline.txt ] && timeline mark eval_done
+		
+		# writes out any ring whose collector was killed along with its pak
+		logring flush
 		
 		if [ -f /tmp/using-swap ]; then
 			rm -f /tmp/using-swap
 			swapoff -a
 		fi
 		sync
+		[ -f /tmp/timeline.txt ] && timeline mark game_sync
 	fi
 done
 
@@ -68,9 +83,15 @@ if [ -f /tmp/minui_update ]; then
 	
 	echo start updating | tee $UPDATE_LOG
 	updateui >> $UPDATE_LOG &
-	notify 0 "extracting package"
-	mkdir -p ${UPDATE_TMP}
-	total=`unzip -l ${UPDATE_ZIP} | wc -l`
-	unzip -d ${UPDATE_TMP} -o ${UPDATE_ZIP} | awk -v total="$total" -v out="/tmp/.update_msg" 'function bname(file,a,n){n=split(file,a,"/");return a[n]}BEGIN{cnt=0}{printf "">out;cnt+=1;printf "%d extract %s\n",cnt*100/total,bname($2)>>out;close(out)}'
-	"$UPDATE_TMP/updater" | tee -a $UPDATE_LOG
+	if [ -f "$SD/System/bin/install-update" ]; then
+		# streams each file straight to its final path, handles paks like update.sh and syncs once
+		install-update "$UPDATE_ZIP" | tee -a $UPDATE_LOG
+		"$SD/System/System.pak/launch.sh"
+	else
+		notify 0 "extracting package"
+		mkdir -p ${UPDATE_TMP}
+		total=`unzip -l ${UPDATE_ZIP} | wc -l`
+		unzip -d ${UPDATE_TMP} -o ${UPDATE_ZIP} | awk -v total="$total" -v out="/tmp/.update_msg" 'function bname(file,a,n){n=split(file,a,"/");return a[n]}BEGIN{cnt=0}{printf "">out;cnt+=1;printf "%d extract %s\n",cnt*100/total,bname($2)>>out;close(out)}'
+		"$UPDATE_TMP/updater" | tee -a $UPDATE_LOG
+	fi
 fi
\ No newline at end of file
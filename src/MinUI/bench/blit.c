@@ -0,0 +1,193 @@
+// device benchmark for MinUI's RGB565 kernels (see blit.h)
+// times each kernel against the SDL blit MinUI used to do the same job
+// onto a 320x240 16bpp surface, build with `make bench-blit` and run it on the device
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <SDL/SDL.h>
+
+#include "blit.h"
+
+///////////////////////////////////////
+
+static double getSeconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static SDL_Surface* createARGB(int w, int h) {
+	return SDL_CreateRGBSurface(SDL_SWSURFACE, w,h, 32, 0x00FF0000,0x0000FF00,0x000000FF,0xFF000000);
+}
+static uint32_t* pixelAt(SDL_Surface* surface, int x, int y) {
+	return (uint32_t*)((uint8_t*)surface->pixels + y * surface->pitch) + x;
+}
+
+// roughly what TTF_RenderUTF8_Blended() produces for a line of the list:
+// mostly empty, solid stems, antialiased edges
+static uint8_t coverageAt(int x, int y) {
+	int cell = x % 9;
+	if (y<3 || y>15 || cell>6) return 0;
+	if (cell==1 || cell==5) return 255;
+	if (cell==0 || cell==6) return 64 + (y * 11) % 128;
+	return (x + y) % 3 ? 0 : 160;
+}
+
+// a round icon, opaque in the middle with a soft edge
+static uint8_t iconAlphaAt(int x, int y, int size) {
+	int r = size / 2;
+	int dx = x - r;
+	int dy = y - r;
+	int d = dx * dx + dy * dy;
+	if (d<(r-2)*(r-2)) return 255;
+	if (d>r*r) return 0;
+	return 128;
+}
+
+///////////////////////////////////////
+
+typedef void (*BenchFunc)(void* userdata);
+
+static double bench(BenchFunc fn, void* userdata, double min_seconds) {
+	int iterations = 0;
+	double start = getSeconds();
+	double elapsed;
+	do {
+		for (int i=0; i<16; i++) fn(userdata);
+		iterations += 16;
+		elapsed = getSeconds() - start;
+	} while (elapsed<min_seconds);
+	return elapsed / iterations * 1000000.0; // us per call
+}
+
+static void report(char* name, int pixels, double sdl_us, double blit_us) {
+	printf("  %-12s %8i px %10.1f us %10.1f us %8.2fx %8.1f Mpx/s\n",
+		name, pixels, sdl_us, blit_us, sdl_us / blit_us, pixels / blit_us
+	);
+}
+
+///////////////////////////////////////
+
+static SDL_Surface* screen;
+
+typedef struct Job {
+	SDL_Surface* surface; // what SDL blits
+	Sprite* sprite; // what the kernels blit
+	uint8_t* coverage;
+	int w;
+	int h;
+	int x;
+	int y;
+} Job;
+
+static void sdlBlit(void* userdata) {
+	Job* job = userdata;
+	SDL_BlitSurface(job->surface, NULL, screen, &(SDL_Rect){job->x,job->y,0,0});
+}
+static void spriteBlit(void* userdata) {
+	Job* job = userdata;
+	Sprite_blit(job->sprite, NULL, screen, job->x,job->y);
+}
+static void coverageBlit(void* userdata) {
+	Job* job = userdata;
+	SDL_LockSurface(screen);
+	for (int y=0; y<job->h; y++) {
+		uint16_t* dst = (uint16_t*)((uint8_t*)screen->pixels + (job->y + y) * screen->pitch) + job->x;
+		Blit_coverage(dst, job->coverage + y * job->w, job->w, RGB565(0xff,0xff,0xff));
+	}
+	SDL_UnlockSurface(screen);
+}
+static void sdlFill(void* userdata) {
+	SDL_FillRect(screen, NULL, 0);
+}
+static void blitFill(void* userdata) {
+	Blit_fill(screen, NULL, 0);
+}
+
+int main(int argc, char* argv[]) {
+	double min_seconds = argc>1 ? atof(argv[1]) : 1.0;
+
+	SDL_Init(0);
+	screen = SDL_CreateRGBSurface(SDL_SWSURFACE, 320,240, 16, 0xF800,0x07E0,0x001F,0);
+
+	// text: a 280x20 line at the list's text origin
+	Job text = {0};
+	text.w = 280;
+	text.h = 20;
+	text.x = 16;
+	text.y = 44;
+	text.surface = createARGB(text.w, text.h);
+	text.coverage = malloc(text.w * text.h);
+	for (int y=0; y<text.h; y++) {
+		for (int x=0; x<text.w; x++) {
+			uint8_t a = coverageAt(x,y);
+			text.coverage[y * text.w + x] = a;
+			*pixelAt(text.surface, x,y) = (a<<24) | 0xFFFFFF;
+		}
+	}
+
+	// icon: a 24x24 status icon with a soft round edge
+	Job icon = {0};
+	icon.w = 24;
+	icon.h = 24;
+	icon.x = 294;
+	icon.y = 6;
+	icon.surface = createARGB(icon.w, icon.h);
+	for (int y=0; y<icon.h; y++) {
+		for (int x=0; x<icon.w; x++) {
+			*pixelAt(icon.surface, x,y) = (iconAlphaAt(x,y,icon.w)<<24) | 0x3366CC;
+		}
+	}
+	icon.sprite = Sprite_fromSurface(icon.surface);
+
+	// bar: the full width translucent selection highlight
+	Job bar = {0};
+	bar.w = 320;
+	bar.h = 32;
+	bar.x = 0;
+	bar.y = 38;
+	bar.surface = createARGB(bar.w, bar.h);
+	for (int y=0; y<bar.h; y++) {
+		for (int x=0; x<bar.w; x++) {
+			uint8_t a = (y==0 || y==bar.h-1) ? 96 : 255;
+			*pixelAt(bar.surface, x,y) = (a<<24) | 0xE6C879;
+		}
+	}
+	bar.sprite = Sprite_fromSurface(bar.surface);
+
+	// title: the opaque top bar
+	Job title = {0};
+	title.w = 320;
+	title.h = 36;
+	title.surface = createARGB(title.w, title.h);
+	for (int y=0; y<title.h; y++) {
+		for (int x=0; x<title.w; x++) {
+			*pixelAt(title.surface, x,y) = 0xFF000000 | (y * 0x060606);
+		}
+	}
+	title.sprite = Sprite_fromSurface(title.surface);
+
+	printf("%.1fs per kernel on a 320x240 16bpp surface\n", min_seconds);
+	printf("  %-12s %11s %13s %13s %9s %14s\n", "job", "size", "SDL", "blit", "speedup", "throughput");
+	report("text", text.w * text.h, bench(sdlBlit, &text, min_seconds), bench(coverageBlit, &text, min_seconds));
+	report("icon", icon.w * icon.h, bench(sdlBlit, &icon, min_seconds), bench(spriteBlit, &icon, min_seconds));
+	report("bar", bar.w * bar.h, bench(sdlBlit, &bar, min_seconds), bench(spriteBlit, &bar, min_seconds));
+	report("title", title.w * title.h, bench(sdlBlit, &title, min_seconds), bench(spriteBlit, &title, min_seconds));
+	report("fill", 320 * 240, bench(sdlFill, NULL, min_seconds), bench(blitFill, NULL, min_seconds));
+
+	Sprite_free(icon.sprite);
+	Sprite_free(bar.sprite);
+	Sprite_free(title.sprite);
+	SDL_FreeSurface(text.surface);
+	SDL_FreeSurface(icon.surface);
+	SDL_FreeSurface(bar.surface);
+	SDL_FreeSurface(title.surface);
+	free(text.coverage);
+	SDL_FreeSurface(screen);
+	SDL_Quit();
+	return 0;
+}
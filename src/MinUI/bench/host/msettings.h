@@ -0,0 +1,19 @@
+#ifndef MSETTINGS_H
+#define MSETTINGS_H
+
+// no-op stand-in for libmsettings so main.c builds into the host render benchmark
+// the benchmark never reaches any of these, they only have to link
+
+static inline void InitSettings(void) {}
+static inline void QuitSettings(void) {}
+
+static inline int GetBrightness(void) { return 0; }
+static inline int GetVolume(void) { return 0; }
+
+static inline void SetRawBrightness(int value) {}
+static inline void SetRawVolume(int value) {}
+
+static inline void SetBrightness(int value) {}
+static inline void SetVolume(int value) {}
+
+#endif
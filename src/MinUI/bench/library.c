@@ -0,0 +1,277 @@
+// host benchmark for MinUI's data path (see library.h)
+// generates synthetic Roms folders under kRootDir then times scanning,
+// sorting, indexing, name cleaning and recents against each of them
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "library.h"
+#include "state.h"
+
+///////////////////////////////////////
+
+// linked with -Wl,--wrap=malloc etc so only allocations made by the library are counted
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static uint64_t alloc_count = 0;
+static uint64_t alloc_bytes = 0;
+
+void* __wrap_malloc(size_t size) {
+	alloc_count += 1;
+	alloc_bytes += size;
+	return __real_malloc(size);
+}
+void* __wrap_calloc(size_t count, size_t size) {
+	alloc_count += 1;
+	alloc_bytes += count * size;
+	return __real_calloc(count, size);
+}
+void* __wrap_realloc(void* ptr, size_t size) {
+	alloc_count += 1;
+	alloc_bytes += size;
+	return __real_realloc(ptr, size);
+}
+void __wrap_free(void* ptr) {
+	__real_free(ptr);
+}
+
+///////////////////////////////////////
+
+static double getSeconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void touch(char* path) {
+	close(open(path, O_RDWR|O_CREAT, 0644));
+}
+
+static char* kRegions[] = {"USA", "Europe", "Japan", "USA, Europe", "World"};
+static char* kTags[] = {"", " (Rev 1)", " (En,Fr,De,Es,It)", " [!]", " (Beta) [b1]", " (Proto) (Hack) [T+Eng1.02]"};
+static char* kWords[] = {"Super", "Mega", "Quest", "Legend", "Dragon", "Star", "Racing", "Puzzle", "Knight", "Zero"};
+
+// roughly one in ten entries is a multi-disc set: a folder with per-disc cue/bin pairs and an m3u
+static void generateTree(char* path, int count) {
+	char marker[256];
+	if (snprintf(marker, sizeof(marker), "%s/.generated", path)>=sizeof(marker)) return;
+	if (exists(marker)) return;
+
+	mkdir(path, 0755);
+	for (int i=0; i<count; i++) {
+		char title[128];
+		snprintf(title, sizeof(title), "%s %s %s %05i (%s)%s",
+			kWords[i % 10], kWords[(i / 10) % 10], kWords[(i / 100) % 10], i,
+			kRegions[i % 5], kTags[i % 6]
+		);
+
+		char file_path[512];
+		if (i % 10==9) {
+			char dir_path[256];
+			if (snprintf(dir_path, sizeof(dir_path), "%s/%s", path, title)>=sizeof(dir_path)) continue;
+			mkdir(dir_path, 0755);
+
+			snprintf(file_path, sizeof(file_path), "%s/%s.m3u", dir_path, title);
+			FILE* m3u = fopen(file_path, "w");
+			for (int disc=1; disc<=3; disc++) {
+				snprintf(file_path, sizeof(file_path), "%s/%s (Disc %i).cue", dir_path, title, disc);
+				touch(file_path);
+				snprintf(file_path, sizeof(file_path), "%s/%s (Disc %i).bin", dir_path, title, disc);
+				touch(file_path);
+				if (m3u) fprintf(m3u, "%s (Disc %i).cue\n", title, disc);
+			}
+			if (m3u) fclose(m3u);
+		}
+		else {
+			if (snprintf(file_path, sizeof(file_path), "%s/%s.gba", path, title)>=sizeof(file_path)) continue;
+			touch(file_path);
+		}
+	}
+	touch(marker);
+}
+
+static void generateCard(void) {
+	mkdir(kRootDir, 0755);
+	mkdir(kRootDir "/.minui", 0755);
+	mkdir(kRootDir "/Emus", 0755);
+	mkdir(kRootDir "/Emus/Bench.pak", 0755);
+	touch(kRootDir "/Emus/Bench.pak/launch.sh");
+	mkdir(kRootDir "/Roms", 0755);
+	mkdir(kRootDir "/Roms/Bench", 0755);
+}
+
+///////////////////////////////////////
+
+typedef struct Result {
+	double seconds;
+	uint64_t allocs;
+	uint64_t bytes;
+	int iterations;
+} Result;
+
+static double result_start;
+static uint64_t result_allocs;
+static uint64_t result_bytes;
+static void Result_begin(void) {
+	result_allocs = alloc_count;
+	result_bytes = alloc_bytes;
+	result_start = getSeconds();
+}
+static void Result_end(Result* self) {
+	self->seconds += getSeconds() - result_start;
+	self->allocs += alloc_count - result_allocs;
+	self->bytes += alloc_bytes - result_bytes;
+	self->iterations += 1;
+}
+static void Result_print(Result* self, char* name, int count) {
+	double seconds = self->seconds / self->iterations;
+	printf("  %-20s %10.3f ms %12.0f entries/s %10.1f allocs/entry %10.1f bytes/entry\n",
+		name,
+		seconds * 1000.0,
+		count / seconds,
+		(double)self->allocs / self->iterations / count,
+		(double)self->bytes / self->iterations / count
+	);
+}
+
+static void shuffle(Array* self) {
+	srand(1);
+	for (int i=self->count-1; i>0; i--) {
+		int j = rand() % (i+1);
+		void* item = self->items[i];
+		self->items[i] = self->items[j];
+		self->items[j] = item;
+	}
+}
+
+static void benchTree(char* path, int min_seconds) {
+	Result scan = {0};
+	Result sort = {0};
+	Result index = {0};
+	Result names = {0};
+	Result lookup = {0};
+	Result hashed = {0};
+
+	int count = 0;
+	double start = getSeconds();
+	while (getSeconds()-start<min_seconds || scan.iterations<3) {
+		// getEntries() scans and sorts, sorting derives each name once
+		Result_begin();
+		Array* entries = getEntries(path);
+		Result_end(&scan);
+		count = entries->count;
+
+		shuffle(entries);
+		Result_begin();
+		EntryArray_sort(entries);
+		Result_end(&sort);
+
+		Directory* directory = malloc(sizeof(Directory));
+		directory->path = copy_string(path);
+		directory->entries = entries;
+		directory->alphas = IntArray_new();
+		directory->selected = 0;
+		directory->lookup = NULL;
+		Result_begin();
+		Directory_index(directory);
+		Result_end(&index);
+
+		Result_begin();
+		for (int i=0; i<count; i++) {
+			Entry* entry = entries->items[i];
+			PathString* base = Path_get(entry->base);
+			raw_name_length(base->str, base->length);
+		}
+		Result_end(&names);
+
+		// worst case for restoring the last selection
+		Entry* last = entries->items[count-1];
+		char last_path[256];
+		Entry_getPath(last, last_path);
+		Result_begin();
+		EntryArray_indexOf(entries, last_path);
+		Result_end(&lookup);
+		Result_begin();
+		Directory_indexOf(directory, last_path);
+		Result_end(&hashed);
+
+		Directory_free(directory);
+	}
+
+	printf("%s (%i entries, %i iterations)\n", path + strlen(kRomsDir), count, scan.iterations);
+	Result_print(&scan, "getEntries", count);
+	Result_print(&sort, "EntryArray_sort", count);
+	Result_print(&index, "Directory_index", count);
+	Result_print(&names, "raw_name_length", count);
+	Result_print(&lookup, "EntryArray_indexOf", count);
+	Result_print(&hashed, "Directory_indexOf", count);
+}
+
+static void benchRecents(char* path, int min_seconds) {
+	// fill the saved recents with the first kMaxRecents entries of the folder
+	Array* entries = getEntries(path);
+	char* saved = malloc(kMaxRecents * 256 + 1);
+	saved[0] = '\0';
+	for (int i=0; i<entries->count && i<kMaxRecents; i++) {
+		Entry* entry = entries->items[i];
+		char entry_path[256];
+		strcat(saved, Entry_getPath(entry, entry_path));
+		strcat(saved, "\n");
+	}
+	State_open();
+	State_set(kStateRecents, saved);
+	State_commit();
+	free(saved);
+	EntryArray_free(entries);
+
+	Result result = {0};
+	double start = getSeconds();
+	while (getSeconds()-start<min_seconds || result.iterations<3) {
+		recents = Array_new();
+		Result_begin();
+		hasRecents();
+		Result_end(&result);
+		StringArray_free(recents);
+	}
+	State_close();
+	printf("recents (%i entries, %i iterations)\n", kMaxRecents, result.iterations);
+	Result_print(&result, "hasRecents", kMaxRecents);
+}
+
+///////////////////////////////////////
+
+int main(int argc, char* argv[]) {
+	int min_seconds = argc>1 ? atoi(argv[1]) : 1;
+
+	int sizes[] = {100, 10000, 100000};
+	int size_count = sizeof(sizes) / sizeof(sizes[0]);
+
+	printf("generating synthetic card at %s\n", kRootDir);
+	generateCard();
+	char paths[3][256];
+	for (int i=0; i<size_count; i++) {
+		snprintf(paths[i], sizeof(paths[i]), kRomsDir "Bench/%i", sizes[i]);
+		generateTree(paths[i], sizes[i]);
+	}
+	puts("");
+
+	for (int i=0; i<size_count; i++) {
+		benchTree(paths[i], min_seconds);
+		puts("");
+	}
+	benchRecents(paths[1], min_seconds);
+
+	return 0;
+}
@@ -0,0 +1,280 @@
+// host benchmark for MinUI's renderer (Render_draw() and the marquee's Render_drawScroll())
+// draws scripted Views headless with SDL's dummy video driver, times each scenario and
+// compares its last frame pixel-for-pixel with bench/golden/<scenario>.bmp
+// build and run with `make bench-render`, a missing or different golden fails the run
+// `make bench-render RECORD=1` rewrites the goldens after an intended change to the UI
+// goldens are only recorded and compared against the SDL MinUI ships (see kGoldenSDL),
+// linked against anything else (eg. sdl12-compat) the scenarios are just timed
+
+// main.c's renderer is all static so build it into this file, its main() is never called
+#define main MinUI_main
+#include "../main.c"
+#undef main
+
+#define kGoldenDir "bench/golden"
+#define kGoldenSDL "1.2.15" // third-party/SDL-1.2
+
+///////////////////////////////////////
+
+static double getSeconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void touch(char* path) {
+	close(open(path, O_RDWR|O_CREAT, 0644));
+}
+
+///////////////////////////////////////
+
+typedef struct Scenario {
+	char* name;
+	char* names[kMaxRows]; // NULL ends the list
+	char* fullnames[kMaxRows]; // only drawn for conflicts
+	int count; // entries in the directory, at least as many as names
+	int selected; // relative to the first row
+	int depth;
+	int show_setting;
+	int setting_value;
+	int setting_max;
+	int resume; // select the rom that has a save state
+	int marquee; // draw this many scroll steps after the first frame
+	int timing_only; // its frame depends on more than the libraries kGoldenSDL pins
+} Scenario;
+
+static Scenario scenarios[] = {
+	{
+		.name = "list",
+		.names = {"Game Boy", "Game Boy Advance", "Game Boy Color", "Nintendo", "Super Nintendo"},
+		.count = 5,
+		.depth = 1,
+	},
+	{
+		.name = "long-names",
+		.names = {
+			"Legend of Zelda, The - Link's Awakening DX",
+			"Final Fantasy Legend III",
+			"Pokemon - Crystal Version",
+			"Mario & Luigi - Superstar Saga + Bowser's Minions",
+			"Tetris",
+		},
+		.count = 42,
+		.selected = 3,
+		.depth = 2,
+	},
+	{
+		.name = "marquee",
+		.names = {
+			"Tetris",
+			"Mario & Luigi - Superstar Saga + Bowser's Minions",
+		},
+		.count = 2,
+		.selected = 1,
+		.depth = 2,
+		.marquee = 64,
+	},
+	{
+		.name = "conflicts",
+		.names = {"Tetris", "Tetris", "Tetris DX"},
+		.fullnames = {"Tetris (Japan) (En).gb", "Tetris (World) (Rev A).gb", NULL},
+		.count = 3,
+		.selected = 1,
+		.depth = 2,
+	},
+	{
+		.name = "brightness",
+		.names = {"Game Boy", "Nintendo"},
+		.count = 2,
+		.depth = 1,
+		.show_setting = 1,
+		.setting_value = 7,
+		.setting_max = 10,
+	},
+	{
+		.name = "volume",
+		.names = {"Game Boy", "Nintendo"},
+		.count = 2,
+		.depth = 1,
+		.show_setting = 2,
+		.setting_value = 13,
+		.setting_max = 20,
+	},
+	{
+		.name = "mute",
+		.names = {"Game Boy", "Nintendo"},
+		.count = 2,
+		.depth = 1,
+		.show_setting = 2,
+		.setting_value = 0,
+		.setting_max = 20,
+	},
+	{
+		.name = "resume",
+		.names = {"Bench Quest", "Resume Quest"},
+		.count = 2,
+		.selected = 1,
+		.depth = 2,
+		.resume = 1,
+	},
+	{
+		.name = "fallback", // glyphs the atlas doesn't have are rendered through SDL_ttf
+		.names = {"\xce\xa9mega \xe2\x80\x9cQuest\xe2\x80\x9d", "\xce\x91\xce\xb8\xce\xae\xce\xbd\xce\xb1 \xe2\x80\x93 Stars"},
+		.count = 2,
+		.selected = 1,
+		.depth = 2,
+		.timing_only = 1, // SDL_ttf draws them with whatever FreeType the host has
+	},
+};
+#define kScenarioCount (sizeof(scenarios)/sizeof(scenarios[0]))
+
+static void Scenario_view(Scenario* self, View* view) {
+	memset(view, 0, sizeof(View));
+	view->generation = 1;
+	view->count = self->count;
+	view->start = 0;
+	view->end = 0;
+	while (view->end<kMaxRows && self->names[view->end]) {
+		ViewRow* row = &view->rows[view->end];
+		snprintf(row->name, sizeof(row->name), "%s", self->names[view->end]);
+		snprintf(row->fullname, sizeof(row->fullname), "%s", self->fullnames[view->end] ? self->fullnames[view->end] : self->names[view->end]);
+		row->conflict = self->fullnames[view->end]!=NULL;
+		view->end += 1;
+	}
+	view->selected = self->selected;
+	view->depth = self->depth;
+	view->show_setting = self->show_setting;
+	view->setting_value = self->setting_value;
+	view->setting_max = self->setting_max;
+	if (self->resume) {
+		strcpy(view->selected_path, kRomsDir "Bench/Resume Quest.gb");
+		view->selected_type = kEntryRom;
+	}
+}
+
+static void Scenario_draw(Scenario* self, View* view) {
+	Render_draw(view);
+	SDL_Flip(screen);
+	for (int ox=1; ox<=self->marquee; ox++) {
+		view->scroll_ox = ox;
+		if (Render_drawScroll(view)) SDL_Flip(screen);
+	}
+	view->scroll_ox = 0;
+}
+
+///////////////////////////////////////
+
+// returns the number of differing pixels, -1 if the golden is missing
+static int compareGolden(char* name) {
+	char path[256];
+	sprintf(path, "%s/%s.bmp", kGoldenDir, name);
+	SDL_Surface* loaded = SDL_LoadBMP(path);
+	if (!loaded) return -1;
+	SDL_Surface* golden = SDL_ConvertSurface(loaded, screen->format, SDL_SWSURFACE);
+	SDL_FreeSurface(loaded);
+	if (!golden || golden->w!=screen->w || golden->h!=screen->h) {
+		if (golden) SDL_FreeSurface(golden);
+		return screen->w * screen->h;
+	}
+
+	int diff = 0;
+	for (int y=0; y<screen->h; y++) {
+		uint16_t* a = (uint16_t*)((uint8_t*)screen->pixels + y * screen->pitch);
+		uint16_t* b = (uint16_t*)((uint8_t*)golden->pixels + y * golden->pitch);
+		for (int x=0; x<screen->w; x++) {
+			if (a[x]!=b[x]) diff += 1;
+		}
+	}
+	SDL_FreeSurface(golden);
+	return diff;
+}
+
+static void saveFrame(char* name, char* suffix) {
+	char path[256];
+	sprintf(path, "%s/%s%s.bmp", kGoldenDir, name, suffix);
+	mkdir(kGoldenDir, 0755);
+	SDL_SaveBMP(screen, path);
+}
+
+///////////////////////////////////////
+
+// the resume probe looks for Roms/<emu>/.mmenu/<rom>.txt
+static void setup(void) {
+	mkdir(kRootDir, 0755);
+	mkdir(kRootDir "/Roms", 0755);
+	mkdir(kRootDir "/Roms/Bench", 0755);
+	mkdir(kRootDir "/Roms/Bench/.mmenu", 0755);
+	touch(kRootDir "/Roms/Bench/Resume Quest.gb");
+	touch(kRootDir "/Roms/Bench/.mmenu/Resume Quest.txt");
+}
+
+int main(int argc, char* argv[]) {
+	int record = 0;
+	int frames = 500;
+	for (int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "--record")) record = 1;
+		else if (!strcmp(argv[i], "--frames") && i+1<argc) frames = atoi(argv[++i]);
+	}
+
+	// a golden recorded on another SDL (or an emulation of 1.2) proves nothing about the device's
+	const SDL_version* linked = SDL_Linked_Version();
+	char sdl[16];
+	sprintf(sdl, "%i.%i.%i", linked->major, linked->minor, linked->patch);
+	int goldens = exact_match(sdl, kGoldenSDL);
+	if (!goldens && record) {
+		printf("not recording goldens against SDL %s, they need SDL %s\n", sdl, kGoldenSDL);
+		return 1;
+	}
+	
+	setup();
+	putenv("SDL_VIDEODRIVER=dummy");
+	if (SDL_Init(SDL_INIT_VIDEO)==-1) {
+		printf("could not init SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	screen = SDL_SetVideoMode(320, 240, 16, SDL_SWSURFACE);
+	TTF_Init();
+	Render_init(); // its thread just waits, everything is drawn from here
+
+	printf("render (%i frames per scenario, assets from %s, SDL %s)\n", frames, kResDir, sdl);
+	if (!goldens) printf("  goldens need SDL %s, only timing\n", kGoldenSDL);
+	printf("  %-12s %10s %10s %10s  %s\n", "scenario", "mean", "min", "frames/s", "golden");
+	int failed = 0;
+	for (int i=0; i<kScenarioCount; i++) {
+		Scenario* scenario = &scenarios[i];
+		View view;
+		Scenario_view(scenario, &view);
+
+		double total = 0;
+		double best = 0;
+		for (int j=0; j<frames; j++) {
+			double start = getSeconds();
+			Scenario_draw(scenario, &view);
+			double elapsed = getSeconds() - start;
+			total += elapsed;
+			if (j==0 || elapsed<best) best = elapsed;
+		}
+
+		char* result;
+		if (!goldens || scenario->timing_only) result = "-";
+		else if (record) {
+			saveFrame(scenario->name, "");
+			result = "recorded";
+		}
+		else {
+			int diff = compareGolden(scenario->name);
+			if (diff==0) result = "identical";
+			else {
+				saveFrame(scenario->name, ".actual");
+				result = diff<0 ? "MISSING, see .actual.bmp" : "DIFFERS, see .actual.bmp";
+				failed += 1;
+			}
+		}
+		printf("  %-12s %8.3fms %8.3fms %10.0f  %s\n", scenario->name, total / frames * 1000, best * 1000, frames / total, result);
+	}
+
+	Render_quit();
+	TTF_Quit();
+	SDL_Quit();
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+
+#include "blit.h"
+#include "memory.h"
+
+///////////////////////////////////////
+
+// the ARM926EJ-S has a 16-byte line and no hardware prefetcher, these become pld
+#define PREFETCH(ptr) __builtin_prefetch((ptr), 0, 0)
+#define PREFETCHW(ptr) __builtin_prefetch((ptr), 1, 0)
+
+// only little-endian targets, the first pixel is the low halfword
+#define PAIR(a,b) ((uint32_t)(a) | ((uint32_t)(b)<<16))
+
+#define kSpreadMask 0x07E0F81F
+
+static inline uint32_t spread(uint16_t c) {
+	return (c | (c<<16)) & kSpreadMask;
+}
+static inline uint16_t unspread(uint32_t c) {
+	c &= kSpreadMask;
+	return c | (c>>16);
+}
+
+// dst scaled by ia/32 then src added, src is premultiplied so channels can't carry
+static inline uint16_t blendPremultiplied(uint16_t dst, uint16_t src, uint32_t ia) {
+	return unspread((spread(dst) * ia) >> 5) + src;
+}
+// alpha 0-32
+static inline uint16_t blendSolid(uint16_t dst, uint32_t src, uint32_t alpha) {
+	return unspread(((src * alpha) + (spread(dst) * (32 - alpha))) >> 5);
+}
+
+///////////////////////////////////////
+
+Sprite* Sprite_fromSurface(SDL_Surface* surface) {
+	if (!surface) return NULL;
+
+	// let SDL normalize whatever IMG_Load produced (palettized, 24-bit, RGBA) to ARGB8888
+	SDL_Surface* format = SDL_CreateRGBSurface(SDL_SWSURFACE, 1,1, 32, 0x00FF0000,0x0000FF00,0x000000FF,0xFF000000);
+	if (!format) return NULL;
+	SDL_Surface* argb = SDL_ConvertSurface(surface, format->format, SDL_SWSURFACE);
+	SDL_FreeSurface(format);
+	if (!argb) return NULL;
+
+	Sprite* self = malloc(sizeof(Sprite));
+	self->w = argb->w;
+	self->h = argb->h;
+	self->opaque = 1;
+	self->pixels = malloc(self->w * self->h * sizeof(uint16_t));
+	self->alpha = malloc(self->w * self->h);
+	Memory_add(kMemorySprites, sizeof(Sprite) + self->w * self->h * 3);
+
+	SDL_LockSurface(argb);
+	for (int y=0; y<self->h; y++) {
+		uint32_t* src = (uint32_t*)((uint8_t*)argb->pixels + y * argb->pitch);
+		uint16_t* pixels = self->pixels + y * self->w;
+		uint8_t* alpha = self->alpha + y * self->w;
+		for (int x=0; x<self->w; x++) {
+			uint32_t c = *src++;
+			uint32_t a = ((c >> 24) + 4) >> 3; // 0-32
+			uint32_t r = (c >> 19) & 0x1f;
+			uint32_t g = (c >> 10) & 0x3f;
+			uint32_t b = (c >>  3) & 0x1f;
+			r = (r * a) >> 5;
+			g = (g * a) >> 5;
+			b = (b * a) >> 5;
+			*pixels++ = (r<<11) | (g<<5) | b;
+			*alpha++ = 32 - a;
+			if (a!=32) self->opaque = 0;
+		}
+	}
+	SDL_UnlockSurface(argb);
+	SDL_FreeSurface(argb);
+	return self;
+}
+Sprite* Sprite_load(char* path) {
+	SDL_Surface* surface = IMG_Load(path);
+	Sprite* self = Sprite_fromSurface(surface);
+	if (surface) SDL_FreeSurface(surface);
+	return self;
+}
+void Sprite_free(Sprite* self) {
+	if (!self) return;
+	Memory_add(kMemorySprites, -(long)(sizeof(Sprite) + self->w * self->h * 3));
+	free(self->pixels);
+	free(self->alpha);
+	free(self);
+}
+
+static void blitRow(uint16_t* dst, uint16_t* src, uint8_t* alpha, int count) {
+	// align dst to a word so pairs can be stored together
+	if (((uintptr_t)dst & 2) && count) {
+		uint32_t ia = *alpha++;
+		if (ia==0) *dst = *src;
+		else if (ia!=32) *dst = blendPremultiplied(*dst, *src, ia);
+		dst++; src++;
+		count -= 1;
+	}
+
+	uint32_t* dst32 = (uint32_t*)dst;
+	while (count>=2) {
+		PREFETCH(alpha + 32);
+		uint32_t ia = alpha[0] | (alpha[1]<<8);
+		if (ia==0) {
+			*dst32 = PAIR(src[0], src[1]);
+		}
+		else if (ia!=0x2020) {
+			uint32_t d = *dst32;
+			uint16_t d0 = d;
+			uint16_t d1 = d >> 16;
+			if (alpha[0]==0) d0 = src[0];
+			else if (alpha[0]!=32) d0 = blendPremultiplied(d0, src[0], alpha[0]);
+			if (alpha[1]==0) d1 = src[1];
+			else if (alpha[1]!=32) d1 = blendPremultiplied(d1, src[1], alpha[1]);
+			*dst32 = PAIR(d0, d1);
+		}
+		dst32++;
+		src += 2;
+		alpha += 2;
+		count -= 2;
+	}
+
+	if (count) {
+		dst = (uint16_t*)dst32;
+		uint32_t ia = *alpha;
+		if (ia==0) *dst = *src;
+		else if (ia!=32) *dst = blendPremultiplied(*dst, *src, ia);
+	}
+}
+
+void Sprite_blit(Sprite* self, SDL_Rect* src, SDL_Surface* dst, int x, int y) {
+	if (!self || dst->format->BytesPerPixel!=2) return;
+
+	int sx = src ? src->x : 0;
+	int sy = src ? src->y : 0;
+	int w = src ? src->w : self->w;
+	int h = src ? src->h : self->h;
+	if (sx+w>self->w) w = self->w - sx;
+	if (sy+h>self->h) h = self->h - sy;
+
+	SDL_Rect* clip = &dst->clip_rect;
+	if (x<clip->x) { int d = clip->x - x; sx += d; w -= d; x = clip->x; }
+	if (y<clip->y) { int d = clip->y - y; sy += d; h -= d; y = clip->y; }
+	if (x+w>clip->x+clip->w) w = clip->x + clip->w - x;
+	if (y+h>clip->y+clip->h) h = clip->y + clip->h - y;
+	if (w<=0 || h<=0) return;
+
+	SDL_LockSurface(dst);
+	for (int row=0; row<h; row++) {
+		uint16_t* d = (uint16_t*)((uint8_t*)dst->pixels + (y + row) * dst->pitch) + x;
+		uint16_t* s = self->pixels + (sy + row) * self->w + sx;
+		PREFETCH(s + self->w);
+		if (self->opaque) memcpy(d, s, w * sizeof(uint16_t));
+		else blitRow(d, s, self->alpha + (sy + row) * self->w + sx, w);
+	}
+	SDL_UnlockSurface(dst);
+}
+
+///////////////////////////////////////
+
+static void fillRow(uint16_t* dst, uint32_t pair, int count) {
+	if (((uintptr_t)dst & 2) && count) {
+		*dst++ = pair;
+		count -= 1;
+	}
+
+	uint32_t* dst32 = (uint32_t*)dst;
+	// four words per iteration so the compiler can use stm
+	while (count>=8) {
+		dst32[0] = pair;
+		dst32[1] = pair;
+		dst32[2] = pair;
+		dst32[3] = pair;
+		dst32 += 4;
+		count -= 8;
+	}
+	while (count>=2) {
+		*dst32++ = pair;
+		count -= 2;
+	}
+
+	if (count) *(uint16_t*)dst32 = pair;
+}
+
+void Blit_fill(SDL_Surface* dst, SDL_Rect* rect, uint16_t color) {
+	if (dst->format->BytesPerPixel!=2) {
+		SDL_FillRect(dst, rect, color);
+		return;
+	}
+
+	SDL_Rect* clip = &dst->clip_rect;
+	int x = rect ? rect->x : clip->x;
+	int y = rect ? rect->y : clip->y;
+	int w = rect ? rect->w : clip->w;
+	int h = rect ? rect->h : clip->h;
+	if (x<clip->x) { w -= clip->x - x; x = clip->x; }
+	if (y<clip->y) { h -= clip->y - y; y = clip->y; }
+	if (x+w>clip->x+clip->w) w = clip->x + clip->w - x;
+	if (y+h>clip->y+clip->h) h = clip->y + clip->h - y;
+	if (w<=0 || h<=0) return;
+
+	SDL_LockSurface(dst);
+	uint32_t pair = PAIR(color, color);
+	// the whole surface is one contiguous run
+	if (x==0 && w==dst->w && dst->pitch==w*2) {
+		fillRow((uint16_t*)((uint8_t*)dst->pixels + y * dst->pitch), pair, w * h);
+	}
+	else {
+		for (int row=0; row<h; row++) {
+			uint16_t* d = (uint16_t*)((uint8_t*)dst->pixels + (y + row) * dst->pitch) + x;
+			PREFETCHW((uint8_t*)d + dst->pitch);
+			fillRow(d, pair, w);
+		}
+	}
+	SDL_UnlockSurface(dst);
+}
+
+///////////////////////////////////////
+
+void Blit_coverage(uint16_t* dst, uint8_t* coverage, int count, uint16_t color) {
+	uint32_t src = spread(color);
+
+	if (((uintptr_t)dst & 2) && count) {
+		uint32_t a = *coverage++;
+		if (a==255) *dst = color;
+		else if (a) *dst = blendSolid(*dst, src, (a + 4) >> 3);
+		dst++;
+		count -= 1;
+	}
+
+	uint32_t* dst32 = (uint32_t*)dst;
+	uint32_t pair = PAIR(color, color);
+	while (count>=2) {
+		uint32_t a = coverage[0] | (coverage[1]<<8);
+		if (a==0xffff) {
+			*dst32 = pair;
+		}
+		else if (a) {
+			uint32_t d = *dst32;
+			uint16_t d0 = d;
+			uint16_t d1 = d >> 16;
+			if (coverage[0]==255) d0 = color;
+			else if (coverage[0]) d0 = blendSolid(d0, src, (coverage[0] + 4) >> 3);
+			if (coverage[1]==255) d1 = color;
+			else if (coverage[1]) d1 = blendSolid(d1, src, (coverage[1] + 4) >> 3);
+			*dst32 = PAIR(d0, d1);
+		}
+		dst32++;
+		coverage += 2;
+		count -= 2;
+	}
+
+	if (count) {
+		dst = (uint16_t*)dst32;
+		uint32_t a = *coverage;
+		if (a==255) *dst = color;
+		else if (a) *dst = blendSolid(*dst, src, (a + 4) >> 3);
+	}
+}
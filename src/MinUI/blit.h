@@ -0,0 +1,32 @@
+#ifndef BLIT_H
+#define BLIT_H
+
+// RGB565 compositing kernels for the 16bpp screen
+// handle two pixels per 32-bit word wherever a pair is fully opaque or fully transparent
+// and blend the rest one pixel at a time with the 0x07E0F81F spread trick
+
+#include <stdint.h>
+#include <SDL/SDL.h>
+
+typedef struct Sprite {
+	int w;
+	int h;
+	int opaque; // no translucent pixels, blits are row copies
+	uint16_t* pixels; // RGB565, already multiplied by alpha
+	uint8_t* alpha; // inverse alpha, 0-32, the weight left to dst
+} Sprite;
+
+Sprite* Sprite_fromSurface(SDL_Surface* surface);
+Sprite* Sprite_load(char* path);
+void Sprite_free(Sprite* self);
+// src may be NULL to blit the whole sprite, clipped to dst's clip rect
+void Sprite_blit(Sprite* self, SDL_Rect* src, SDL_Surface* dst, int x, int y);
+
+// rect may be NULL to fill the whole surface
+void Blit_fill(SDL_Surface* dst, SDL_Rect* rect, uint16_t color);
+// one row of 8-bit coverage in a solid color, eg. a row of a glyph
+void Blit_coverage(uint16_t* dst, uint8_t* coverage, int count, uint16_t color);
+
+#define RGB565(r,g,b) ((((r)>>3)<<11) | (((g)>>2)<<5) | ((b)>>3))
+
+#endif
@@ -0,0 +1,770 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "library.h"
+#include "memory.h"
+#include "state.h"
+
+///////////////////////////////////////
+
+// NOTE: these are now case-insensitive!
+int match_prefix(char* pre, char* str) {
+	return (strncasecmp(pre,str,strlen(pre))==0);
+}
+int match_suffix(char* suf, char* str) {
+	int len = strlen(suf);
+	return (strncasecmp(suf, str+strlen(str)-len, len)==0);
+}
+// NOTE: this is still case-sensitive
+int exact_match(char* str1, char* str2) {
+	return strcmp(str1,str2)==0; // one pass, no strlen()s
+}
+void concat(char* str1, char* str2, int maxlen) {
+	int len1 = strlen(str1);
+	int len2 = strlen(str2);
+	if (len1+len2+1>maxlen) puts("concat overstepped its bounds"); // TODO: lock this down
+	strncpy(str1+len1, str2, len2);
+	str1[len1+len2] = 0;
+}
+char* copy_string(char* str) {
+	int len = strlen(str);
+	char* copy = malloc(sizeof(char)*(len+1));
+	strcpy(copy, str);
+	copy[len] = '\0';
+	return copy;
+} // NOTE: caller must free() result!
+
+///////////////////////////////////////
+
+// only use to write single-line files!
+int put_file(char* path, char* contents) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		printf("could not write %s\n", path);
+		return 0;
+	}
+	int ok = fputs(contents, file)>=0;
+	if (fclose(file)!=0) ok = 0;
+	if (!ok) printf("could not write %s\n", path);
+	return ok;
+}
+void get_file(char* path, char* buffer) {
+	buffer[0] = '\0';
+	FILE *file = fopen(path, "r");
+	if (!file) return;
+	fseek(file, 0L, SEEK_END);
+	size_t size = ftell(file);
+	rewind(file);
+	fread(buffer, sizeof(char), size, file);
+	fclose(file);
+	buffer[size] = '\0';
+}
+
+///////////////////////////////////////
+
+#define kPathBlockSize (64 * 1024)
+
+typedef struct PathBlock {
+	struct PathBlock* next;
+	int used;
+	int size;
+	char data[];
+} PathBlock;
+
+static PathBlock* path_blocks = NULL; // where the strings live, newest first
+static PathString* path_strings = NULL; // indexed by id
+static int path_count = 0;
+static int path_capacity = 0;
+static int* path_lookup = NULL; // open addressed on hash, holds id+1, 0 is empty
+static int path_lookup_size = 0; // a power of two
+
+static uint32_t hash_string(char* str, int length) { // FNV-1a
+	uint32_t hash = 2166136261u;
+	for (int i=0; i<length; i++) {
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static char* Path_store(char* str, int length) {
+	if (!path_blocks || path_blocks->used+length+1>path_blocks->size) {
+		int size = length+1>kPathBlockSize ? length+1 : kPathBlockSize;
+		PathBlock* block = malloc(sizeof(PathBlock) + size);
+		Memory_add(kMemoryPaths, sizeof(PathBlock) + size);
+		block->next = path_blocks;
+		block->used = 0;
+		block->size = size;
+		path_blocks = block;
+	}
+	char* copy = path_blocks->data + path_blocks->used;
+	memcpy(copy, str, length);
+	copy[length] = '\0';
+	path_blocks->used += length+1;
+	return copy;
+}
+static int Path_slot(char* str, int length, uint32_t hash) { // of str or the empty slot it would go in
+	int mask = path_lookup_size-1;
+	int slot = hash & mask;
+	while (path_lookup[slot]) {
+		PathString* string = &path_strings[path_lookup[slot]-1];
+		if (string->hash==hash && string->length==length && !memcmp(string->str, str, length)) break;
+		slot = (slot+1) & mask;
+	}
+	return slot;
+}
+static void Path_grow(void) {
+	int size = path_lookup_size ? path_lookup_size*2 : 1024;
+	free(path_lookup);
+	path_lookup = calloc(size, sizeof(int));
+	Memory_add(kMemoryPaths, (size - path_lookup_size) * sizeof(int));
+	path_lookup_size = size;
+	for (int id=0; id<path_count; id++) {
+		int slot = path_strings[id].hash & (size-1);
+		while (path_lookup[slot]) slot = (slot+1) & (size-1);
+		path_lookup[slot] = id+1;
+	}
+}
+
+int Path_intern(char* str, int length) {
+	if (path_count*2>=path_lookup_size) Path_grow(); // keep probes short
+	uint32_t hash = hash_string(str, length);
+	int slot = Path_slot(str, length, hash);
+	if (path_lookup[slot]) return path_lookup[slot]-1;
+	
+	if (path_count==path_capacity) {
+		int capacity = path_capacity ? path_capacity*2 : 1024;
+		path_strings = realloc(path_strings, sizeof(PathString) * capacity);
+		Memory_add(kMemoryPaths, (capacity - path_capacity) * sizeof(PathString));
+		path_capacity = capacity;
+	}
+	PathString* string = &path_strings[path_count];
+	string->str = Path_store(str, length);
+	string->length = length;
+	string->hash = hash;
+	path_lookup[slot] = ++path_count;
+	return path_count-1;
+}
+int Path_find(char* str, int length) {
+	if (!path_count) return -1;
+	int slot = Path_slot(str, length, hash_string(str, length));
+	return path_lookup[slot]-1;
+}
+PathString* Path_get(int id) {
+	return &path_strings[id]; // NOTE: only until the next Path_intern()
+}
+int Path_split(char* path, int* dir, int* base) {
+	char* slash = strrchr(path, '/');
+	if (!slash) return 0;
+	*dir = Path_find(path, slash-path);
+	*base = Path_find(slash+1, strlen(slash+1));
+	return *dir>=0 && *base>=0;
+}
+void Path_quit(void) {
+	while (path_blocks) {
+		PathBlock* next = path_blocks->next;
+		Memory_add(kMemoryPaths, -(long)(sizeof(PathBlock) + path_blocks->size));
+		free(path_blocks);
+		path_blocks = next;
+	}
+	Memory_add(kMemoryPaths, -(long)(path_capacity * sizeof(PathString) + path_lookup_size * sizeof(int)));
+	free(path_strings);
+	free(path_lookup);
+	path_strings = NULL;
+	path_lookup = NULL;
+	path_count = 0;
+	path_capacity = 0;
+	path_lookup_size = 0;
+}
+
+///////////////////////////////////////
+
+static int hide(char* name) {
+	if (name[0]=='.') return 1;
+	
+	// TODO: these might not be necessary? unless a user just renames their stock folders...
+	if (match_suffix("_cache.db", name)) return 1;
+	if (match_prefix("COPYING", name)) return 1;
+	if (exact_match("license", name)) return 1;
+	if (exact_match("LICENSE", name)) return 1;
+
+	return 0;
+}
+
+///////////////////////////////////////
+
+Array* Array_new(void) {
+	Array* self = malloc(sizeof(Array));
+	self->count = 0;
+	self->capacity = 8;
+	self->items = malloc(sizeof(void*) * self->capacity);
+	Memory_add(kMemoryLists, sizeof(Array) + sizeof(void*) * self->capacity);
+	return self;
+}
+void Array_push(Array* self, void* item) {
+	if (self->count>=self->capacity) {
+		Memory_add(kMemoryLists, sizeof(void*) * self->capacity);
+		self->capacity *= 2;
+		self->items = realloc(self->items, sizeof(void*) * self->capacity);
+	}
+	self->items[self->count++] = item;
+}
+void Array_unshift(Array* self, void* item) {
+	if (self->count==0) return Array_push(self, item);
+	Array_push(self, NULL); // ensures we have enough capacity
+	for (int i=self->count-2; i>=0; i--) {
+		self->items[i+1] = self->items[i];
+	}
+	self->items[0] = item;
+}
+void* Array_pop(Array* self) {
+	if (self->count==0) return NULL;
+	return self->items[--self->count];
+} // NOTE: caller must free result (when appropriate)!
+void Array_free(Array* self) {
+	Memory_add(kMemoryLists, -(long)(sizeof(Array) + sizeof(void*) * self->capacity));
+	free(self->items); // NOTE: caller is responsible for freeing individual items first!
+	free(self);
+}
+void Array_reverse(Array* self) {
+	int end = self->count-1;
+	int mid = self->count/2;
+	for (int i=0; i<mid; i++) {
+		void* item = self->items[i];
+		self->items[i] = self->items[end-i];
+		self->items[end-i] = item;
+	}
+}
+
+///////////////////////////////////////
+
+// one pass over the file name, the result is always a prefix of it: up to the
+// first tag or the extension, whichever comes first, minus trailing spaces
+// a name that's all tags keeps them, only losing its extension
+int raw_name_length(char* file_name, int length) {
+	int tag = -1;
+	int dot = -1;
+	for (int i=0; i<length; i++) {
+		char c = file_name[i];
+		if ((c=='(' || c=='[') && tag==-1) tag = i;
+		else if (c=='.') dot = i;
+	}
+	int safe = dot==-1 ? length : dot;
+	int end = tag==-1 || tag>safe ? safe : tag;
+	while (end>1 && isspace((unsigned char)file_name[end-1])) end--;
+	if (end==0) end = safe;
+	return end;
+}
+
+static int index_char(char* str) {
+	char i = 0;
+	char c = tolower(str[0]);
+	if (c>='a' && c<='z') i = (c-'a')+1;
+	return i;
+}
+
+///////////////////////////////////////
+
+static Entry* Entry_newIn(int dir, char* file_name, int type) {
+	Entry* self = malloc(sizeof(Entry));
+	self->type = type;
+	self->dir = dir;
+	self->base = Path_intern(file_name, strlen(file_name));
+	self->name = NULL;
+	self->name_length = -1; // derived when first sorted, indexed or shown
+	Memory_add(kMemoryEntries, sizeof(Entry));
+	self->alpha = 0;
+	self->conflict = 0;
+	return self;
+}
+Entry* Entry_new(char* path, int type) {
+	char* slash = strrchr(path, '/');
+	return Entry_newIn(Path_intern(path, slash-path), slash+1, type);
+}
+void Entry_free(Entry* self) {
+	Memory_add(kMemoryEntries, -(long)(sizeof(Entry) + (self->name ? self->name_length + 1 : 0)));
+	free(self->name);
+	free(self);
+}
+static char* Entry_getNameString(Entry* self) {
+	if (self->name) return self->name;
+	PathString* base = Path_get(self->base);
+	if (self->name_length==-1) self->name_length = raw_name_length(base->str, base->length);
+	return base->str;
+} // NOTE: only the first name_length chars are the name
+char* Entry_getName(Entry* self, char* name) {
+	char* str = Entry_getNameString(self);
+	int length = self->name_length<256 ? self->name_length : 255;
+	memcpy(name, str, length);
+	name[length] = '\0';
+	return name;
+}
+void Entry_setName(Entry* self, char* name) {
+	Memory_add(kMemoryEntries, (long)strlen(name) + 1 - (self->name ? self->name_length + 1 : 0));
+	free(self->name);
+	self->name = copy_string(name);
+	self->name_length = strlen(name);
+}
+char* Entry_getPath(Entry* self, char* path) {
+	PathString* dir = Path_get(self->dir);
+	PathString* base = Path_get(self->base);
+	if (dir->length+1+base->length<256) {
+		memcpy(path, dir->str, dir->length);
+		path[dir->length] = '/';
+		memcpy(path+dir->length+1, base->str, base->length+1);
+	}
+	else snprintf(path, 256, "%s/%s", dir->str, base->str);
+	return path;
+}
+char* Entry_getFileName(Entry* self) {
+	return Path_get(self->base)->str;
+}
+
+int EntryArray_indexOf(Array* self, char* path) {
+	int dir,base;
+	if (!Path_split(path, &dir, &base)) return -1;
+	for (int i=0; i<self->count; i++) {
+		Entry* entry = self->items[i];
+		if (entry->dir==dir && entry->base==base) return i;
+	}
+	return -1;
+}
+// same order as strcasecmp() on copies of the names
+static int EntryArray_sortEntry(const void* a, const void* b) {
+	Entry* item1 = *(Entry**)a;
+	Entry* item2 = *(Entry**)b;
+	char* name1 = Entry_getNameString(item1);
+	char* name2 = Entry_getNameString(item2);
+	int length = item1->name_length<item2->name_length ? item1->name_length : item2->name_length;
+	int result = strncasecmp(name1, name2, length);
+	return result ? result : item1->name_length - item2->name_length;
+}
+void EntryArray_sort(Array* self) {
+	qsort(self->items, self->count, sizeof(void*), EntryArray_sortEntry);
+}
+
+void EntryArray_free(Array* self) {
+	for (int i=0; i<self->count; i++) {
+		Entry_free(self->items[i]);
+	}
+	Array_free(self);
+}
+
+///////////////////////////////////////
+
+int exists(char* path) {
+	return access(path, F_OK)==0;
+}
+
+void StringArray_free(Array* self) {
+	for (int i=0; i<self->count; i++) {
+		free(self->items[i]);
+	}
+	Array_free(self);
+}
+int StringArray_indexOf(Array* self, char* str) {
+	for (int i=0; i<self->count; i++) {
+		if (exact_match(self->items[i], str)) return i;
+	}
+	return -1;
+}
+
+Array* recents;
+static void saveRecents(void) {
+	char* joined = malloc(recents->count * 256 + 1);
+	char* tmp = joined;
+	for (int i=0; i<recents->count; i++) {
+		tmp = stpcpy(tmp, recents->items[i]);
+		*tmp++ = '\n';
+	}
+	*tmp = '\0';
+	State_set(kStateRecents, joined); // committed along with whatever launches next
+	free(joined);
+}
+void addRecent(char* path) {
+	int id = StringArray_indexOf(recents, path);
+	if (id==-1) { // add
+		while (recents->count>=kMaxRecents) {
+			free(Array_pop(recents));
+		}
+		Array_unshift(recents, copy_string(path));
+	}
+	else if (id>0) { // bump to top
+		for (int i=id; i>0; i--) {
+			void* tmp = recents->items[i-1];
+			recents->items[i-1] = recents->items[i];
+			recents->items[i] = tmp;
+		}
+	}
+	saveRecents();
+}
+int hasRecents(void) {
+	int has = 0;
+	
+	Array* parent_paths = Array_new();
+	if (exists(kChangeDiscPath)) {
+		char disc_path[256];
+		get_file(kChangeDiscPath, disc_path);
+		if (exists(disc_path)) {
+			Array_push(recents, copy_string(disc_path));
+			
+			char parent_path[256];
+			strcpy(parent_path, disc_path);
+			char* tmp = strrchr(parent_path, '/') + 1;
+			tmp[0] = '\0';
+			Array_push(parent_paths, copy_string(parent_path));
+		}
+		unlink(kChangeDiscPath);
+	}
+	
+	char* saved = State_get(kStateRecents); // newest at top
+	if (saved) {
+		char line[256];
+		while (*saved) {
+			int len = strcspn(saved, "\n");
+			snprintf(line, sizeof(line), "%.*s", len, saved);
+			saved += saved[len] ? len + 1 : len;
+			if (len>=(int)sizeof(line)) continue; // too long to have been a path
+			if (len>0 && line[len-1]=='\r') {
+				line[len-1] = 0; // trim Windows newline (recent.txt may have been edited)
+				len -= 1;
+			}
+			if (len==0) continue; // skip empty lines
+			
+			if (exists(line)) {
+				has = 1;
+				if (recents->count<kMaxRecents) {
+					if (match_suffix(".cue", line)) {
+						char parent_path[256];
+						strcpy(parent_path, line);
+						char* tmp = strrchr(parent_path, '/') + 1;
+						tmp[0] = '\0';
+						
+						int found = 0;
+						for (int i=0; i<parent_paths->count; i++) {
+							char* path = parent_paths->items[i];
+							if (match_prefix(path, parent_path)) {
+								found = 1;
+								break;
+							}
+						}
+						if (found) continue;
+						
+						Array_push(parent_paths, copy_string(parent_path));
+					}
+					Array_push(recents, copy_string(line));
+				}
+			}
+		}
+	}
+	
+	saveRecents();
+	
+	StringArray_free(parent_paths);
+	return has;
+}
+static int hasPaks(char* path) {
+	int has = 0;
+
+	DIR *dh = opendir(path);
+	if (dh!=NULL) {
+		struct dirent *dp;
+		while((dp = readdir(dh)) != NULL) {
+			int is_dir = dp->d_type==DT_DIR;
+			if (is_dir && match_suffix(".pak", dp->d_name)) {
+				char pak[256];
+				pak[0] = '\0';
+				concat(pak, path, 256);
+				concat(pak, "/", 256);
+				concat(pak, dp->d_name, 256);
+				concat(pak, "/launch.sh", 256);
+				if (exists(pak)) {
+					has = 1;
+					break;
+				}
+			}
+		}
+		closedir(dh);
+	}
+	return has;
+}
+static int hasRoms(char* path) {
+	int has = 0;
+	
+	// makes sure we have an emu pak
+	char emu[256];
+	strcpy(emu, path);
+	strncpy(emu, kEmusDir, strlen(kEmusDir));
+	concat(emu, ".pak/launch.sh", 256);
+	if (!exists(emu)) return has;
+	
+	// now look for at least one rom
+	DIR *dh = opendir(path);
+	if (dh!=NULL) {
+		struct dirent *dp;
+		while((dp = readdir(dh)) != NULL) {
+			if (hide(dp->d_name)) continue;
+			// if (dp->d_type==DT_DIR) continue;
+			has = 1;
+			break;
+		}
+		closedir(dh);
+	}
+	return has;
+}
+static int hasUpdate(void) {
+	int has = 0;
+	if (exists(kTrimuiUpdatePath)) {
+		struct stat st; 
+		if (stat(kTrimuiUpdatePath, &st)==0 && st.st_size>512) {
+			has = 1;
+		}
+	}
+	return has;
+}
+
+Array* getRecents(void) {
+	Array* entries = Array_new();
+	for (int i=0; i<recents->count; i++) {
+		char* path = recents->items[i];
+		int type = match_suffix(".pak", path) ? kEntryPak : kEntryRom;
+		Array_push(entries, Entry_new(path, type));
+	}
+	return entries;
+}
+Array* getEntries(char* path) {
+	Array* entries = Array_new();
+	DIR *dh = opendir(path);
+	if (dh!=NULL) {
+		struct dirent *dp;
+		int dir = Path_intern(path, strlen(path));
+		while((dp = readdir(dh)) != NULL) {
+			if (hide(dp->d_name)) continue;
+			int is_dir = dp->d_type==DT_DIR;
+			int type;
+			if (is_dir) {
+				if (match_suffix(".pak", dp->d_name)) {
+					type = kEntryPak;
+				}
+				else {
+					type = kEntryDir;
+				}
+			}
+			else {
+				type = kEntryRom;
+			}
+			Array_push(entries, Entry_newIn(dir, dp->d_name, type));
+		}
+		closedir(dh);
+	}
+	EntryArray_sort(entries);
+	return entries;
+}
+int has_roms = 0;
+Array* getRoot(void) {
+	Array* entries = Array_new();
+
+	int has_recents = hasRecents();
+	int has_games = hasPaks(kRootDir "/Games");
+	int has_tools = hasPaks(kRootDir "/Tools");
+	int has_update = hasUpdate();
+	
+	if (has_recents) Array_push(entries, Entry_new(kRecentlyPlayedDir, kEntryDir));
+	
+	char* path = kRootDir "/Roms";
+	DIR *dh = opendir(path);
+	if (dh!=NULL) {
+		struct dirent *dp;
+		char full_path[256];
+		full_path[0] = '\0';
+		concat(full_path, path, 256);
+		concat(full_path, "/", 256);
+		char* tmp = full_path + strlen(full_path);
+		int dir = Path_intern(path, strlen(path));
+		Array* emus = Array_new();
+		while((dp = readdir(dh)) != NULL) {
+			if (hide(dp->d_name)) continue;
+			strcpy(tmp, dp->d_name);
+			tmp[strlen(dp->d_name)] = '\0';
+			
+			if (hasRoms(full_path)) {
+				Array_push(emus, Entry_newIn(dir, dp->d_name, kEntryDir));
+				has_roms = 1;
+			}
+		}
+		EntryArray_sort(emus);
+		for (int i=0; i<emus->count; i++) {
+			Array_push(entries, emus->items[i]);
+		}
+		Array_free(emus); // just free the array part, root now owns emus entries
+		closedir(dh);
+	}
+	
+	if (has_games) Array_push(entries, Entry_new(kRootDir "/Games", kEntryDir));
+	if (has_tools) Array_push(entries, Entry_new(kRootDir "/Tools", kEntryDir));
+	if (has_update) Array_push(entries, Entry_new(kRootDir "/System/Update.pak", kEntryPak));
+	
+	return entries;
+}
+Array* getDiscs(char* path) {
+	Array* entries = Array_new();
+	
+	char base_path[256];
+	strcpy(base_path, path);
+	char* tmp = strrchr(base_path, '/') + 1;
+	tmp[0] = '\0';
+	
+	// TODO: limit number of discs supported (to 9?)
+	FILE* file = fopen(path, "r");
+	if (file) {
+		char line[256];
+		int disc = 0;
+		while (fgets(line,256,file)!=NULL) {
+			int len = strlen(line);
+			if (len>0 && line[len-1]=='\n') {
+				line[len-1] = 0; // trim newline
+				len -= 1;
+				if (len>0 && line[len-1]=='\r') {
+					line[len-1] = 0; // trim Windows newline
+					len -= 1;
+				}
+			}
+			if (len==0) continue; // skip empty lines
+			
+			char disc_path[256];
+			strcpy(disc_path, base_path);
+			concat(disc_path, line, 256);
+						
+			if (exists(disc_path)) {
+				disc += 1;
+				Entry* entry = Entry_new(disc_path, kEntryRom);
+				char name[16];
+				sprintf(name, "Disc %i", disc);
+				Entry_setName(entry, name);
+				Array_push(entries, entry);
+			}
+		}
+		fclose(file);
+	}
+	return entries;
+}
+
+///////////////////////////////////////
+
+IntArray* IntArray_new(void) {
+	IntArray* self = malloc(sizeof(IntArray));
+	Memory_add(kMemoryDirectories, sizeof(IntArray));
+	self->count = 0;
+	self->items[0] = 0; // TODO: zero all entries?
+	return self;
+}
+void IntArray_push(IntArray* self, int i) {
+	if (self->count==kIntArrayMax) {
+		puts("IntArray items exceeded kIntArrayMax");
+		return;
+	}
+	self->items[self->count++] = i;
+}
+void IntArray_free(IntArray* self) {
+	Memory_add(kMemoryDirectories, -(long)sizeof(IntArray));
+	free(self);
+}
+
+///////////////////////////////////////
+
+static uint32_t hash_entry(int dir, int base) {
+	return (uint32_t)dir * 2654435761u ^ (uint32_t)base * 40503u;
+}
+
+void Directory_index(Directory* self) {
+	int size = 16;
+	while (size<self->entries->count*2) size *= 2;
+	self->lookup = calloc(size, sizeof(int));
+	self->lookup_size = size;
+	Memory_add(kMemoryDirectories, size * sizeof(int));
+	for (int i=0; i<self->entries->count; i++) {
+		Entry* entry = self->entries->items[i];
+		int slot = hash_entry(entry->dir, entry->base) & (size-1);
+		while (self->lookup[slot]) slot = (slot+1) & (size-1);
+		self->lookup[slot] = i+1;
+	}
+	
+	Entry* prior = NULL;
+	int alpha = -1;
+	int index = 0;
+	for (int i=0; i<self->entries->count; i++) {
+		Entry* entry = self->entries->items[i];
+		char* name = Entry_getNameString(entry);
+		if (prior!=NULL && prior->name_length==entry->name_length && !strncmp(Entry_getNameString(prior), name, entry->name_length)) {
+			prior->conflict = 1;
+			entry->conflict = 1;
+		}
+		int a = index_char(name);
+		if (a!=alpha) {
+			index = self->alphas->count;
+			IntArray_push(self->alphas, i);
+			alpha = a;
+		}
+		entry->alpha = index;
+		
+		prior = entry;
+	}
+}
+
+int Directory_indexOf(Directory* self, char* path) {
+	int dir,base;
+	if (!Path_split(path, &dir, &base)) return -1;
+	int mask = self->lookup_size-1;
+	for (int slot=hash_entry(dir,base)&mask; self->lookup[slot]; slot=(slot+1)&mask) {
+		Entry* entry = self->entries->items[self->lookup[slot]-1];
+		if (entry->dir==dir && entry->base==base) return self->lookup[slot]-1;
+	}
+	return -1;
+}
+
+Directory* Directory_new(char* path, int selected) {
+	Directory* self = malloc(sizeof(Directory));
+	self->path = copy_string(path);
+	Memory_add(kMemoryDirectories, sizeof(Directory) + strlen(path) + 1);
+	if (exact_match(path, kRootDir)) {
+		self->entries = getRoot();
+	}
+	else if (exact_match(path, kRecentlyPlayedDir)) {
+		self->entries = getRecents();
+	}
+	else if (match_suffix(".m3u", path)) {
+		self->entries = getDiscs(path);
+	}
+	else {
+		self->entries = getEntries(path);
+	}
+	self->alphas = IntArray_new();
+	self->selected = selected;
+	Directory_index(self);
+	return self;
+}
+void Directory_free(Directory* self) {
+	Memory_add(kMemoryDirectories, -(long)(sizeof(Directory) + strlen(self->path) + 1 + self->lookup_size * sizeof(int)));
+	free(self->path);
+	EntryArray_free(self->entries);
+	IntArray_free(self->alphas);
+	free(self->lookup);
+	free(self);
+}
+
+void DirectoryArray_pop(Array* self) {
+	Directory_free(Array_pop(self));
+}
+void DirectoryArray_free(Array* self) {
+	for (int i=0; i<self->count; i++) {
+		Directory_free(self->items[i]);
+	}
+	Array_free(self);
+}
@@ -0,0 +1,156 @@
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+// scanning, sorting, indexing and naming of the SD card's contents
+// has no SDL dependency so it can also be built and benchmarked on a host
+
+#include <stdint.h>
+
+///////////////////////////////////////
+
+// override with -DkRootDir=... to point a host build at a synthetic card
+#ifndef kRootDir
+#define kRootDir "/mnt/SDCARD"
+#endif
+
+#define kEmusDir kRootDir "/Emus/"
+#define kRomsDir kRootDir "/Roms/"
+#define kResDir kRootDir "/System/res/"
+#define kRecentlyPlayedDir kRootDir "/Recently Played"
+#define kLastPath "/tmp/last.txt"
+#define kChangeDiscPath "/tmp/change_disc.txt"
+#define kResumeSlotPath "/tmp/mmenu_slot.txt"
+#define kNextPath "/tmp/next.sh" // tmpfs, it's eval'd and removed as soon as MinUI exits
+#define kTrimuiUpdatePath kRootDir "/TrimuiUpdate_MinUI.zip"
+#define kScreenshotPathTemplate kRootDir "/.minui/screenshots/screenshot-%03i.bmp"
+
+///////////////////////////////////////
+
+// NOTE: these are now case-insensitive!
+int match_prefix(char* pre, char* str);
+int match_suffix(char* suf, char* str);
+// NOTE: this is still case-sensitive
+int exact_match(char* str1, char* str2);
+void concat(char* str1, char* str2, int maxlen);
+char* copy_string(char* str); // NOTE: caller must free() result!
+
+// only use to write single-line files! returns 0 on failure
+int put_file(char* path, char* contents);
+void get_file(char* path, char* buffer);
+int exists(char* path);
+
+///////////////////////////////////////
+
+typedef struct Array {
+	int count;
+	int capacity;
+	void** items;
+} Array;
+
+Array* Array_new(void);
+void Array_push(Array* self, void* item);
+void Array_unshift(Array* self, void* item);
+void* Array_pop(Array* self); // NOTE: caller must free result (when appropriate)!
+void Array_free(Array* self); // NOTE: caller is responsible for freeing individual items first!
+void Array_reverse(Array* self);
+
+void StringArray_free(Array* self);
+int StringArray_indexOf(Array* self, char* str);
+
+///////////////////////////////////////
+
+// every folder path and file name is stored once, in a table that lives until Path_quit()
+// ids stay valid and equal strings always get the same id so paths compare as two ints
+
+typedef struct PathString {
+	char* str;
+	int length;
+	uint32_t hash;
+} PathString;
+
+int Path_intern(char* str, int length); // returns the id of str's first length chars
+int Path_find(char* str, int length); // -1 if never interned
+PathString* Path_get(int id);
+// splits path at its last slash, returns 0 if either half was never interned
+int Path_split(char* path, int* dir, int* base);
+void Path_quit(void);
+
+///////////////////////////////////////
+
+int raw_name_length(char* file_name, int length); // a display name is always a prefix of its file name
+
+enum EntryType {
+	kEntryDir,
+	kEntryPak,
+	kEntryRom,
+};
+typedef struct Entry {
+	int dir; // path table id of the parent folder
+	int base; // path table id of the file name
+	char* name; // NULL unless set by Entry_setName(), otherwise the first name_length chars of the file name
+	int name_length; // -1 until first sorted, indexed or shown
+	int type;
+	int alpha; // index in parent Directory's alphas Array, which points to the index of an Entry in its entries Array :sweat_smile:
+	int conflict;
+} Entry;
+
+Entry* Entry_new(char* path, int type);
+void Entry_free(Entry* self);
+char* Entry_getPath(Entry* self, char* path); // fills and returns path, which must hold 256 chars
+char* Entry_getFileName(Entry* self); // owned by the path table
+char* Entry_getName(Entry* self, char* name); // fills and returns name, which must hold 256 chars
+void Entry_setName(Entry* self, char* name); // overrides the name derived from the file name
+
+int EntryArray_indexOf(Array* self, char* path);
+void EntryArray_sort(Array* self);
+void EntryArray_free(Array* self);
+
+///////////////////////////////////////
+
+#define kMaxRecents 40
+extern Array* recents;
+extern int has_roms;
+
+void addRecent(char* path);
+int hasRecents(void);
+
+Array* getRecents(void);
+Array* getEntries(char* path);
+Array* getRoot(void);
+Array* getDiscs(char* path);
+
+///////////////////////////////////////
+
+#define kIntArrayMax 27
+typedef struct IntArray {
+	int count;
+	int items[kIntArrayMax];
+} IntArray;
+
+IntArray* IntArray_new(void);
+void IntArray_push(IntArray* self, int i);
+void IntArray_free(IntArray* self);
+
+///////////////////////////////////////
+
+typedef struct Directory {
+	char* path;
+	Array* entries;
+	IntArray* alphas;
+	int* lookup; // open addressed on dir and base, holds entry index+1, 0 is empty
+	int lookup_size; // a power of two
+	// rendering
+	int selected;
+	int start;
+	int end;
+} Directory;
+
+void Directory_index(Directory* self); // call once, also builds lookup
+int Directory_indexOf(Directory* self, char* path); // -1 if path isn't one of its entries
+Directory* Directory_new(char* path, int selected);
+void Directory_free(Directory* self);
+
+void DirectoryArray_pop(Array* self);
+void DirectoryArray_free(Array* self);
+
+#endif
@@ -15,21 +15,23 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <linux/input.h>
+#include <malloc.h>
+#include <errno.h>
 #include <msettings.h>
 
-///////////////////////////////////////
-
-#define kRootDir "/mnt/SDCARD"
-#define kEmusDir kRootDir "/Emus/"
-#define kRomsDir kRootDir "/Roms/"
-#define kResDir kRootDir "/System/res/"
-#define kRecentlyPlayedDir kRootDir "/Recently Played"
-#define kLastPath "/tmp/last.txt"
-#define kChangeDiscPath "/tmp/change_disc.txt"
-#define kResumeSlotPath "/tmp/mmenu_slot.txt"
-#define kTrimuiUpdatePath kRootDir "/TrimuiUpdate_MinUI.zip"
-#define kScreenshotsPath kRootDir "/.minui/screenshots.txt"
-#define kScreenshotPathTemplate kRootDir "/.minui/screenshots/screenshot-%03i.bmp"
+#include "../keymon/keyshm.h"
+#include "../keymon/powerstats.h"
+#include "../timeline/timeline.h"
+#include "library.h"
+#include "text.h"
+#include "blit.h"
+#include "prewarm.h"
+#include "memory.h"
+#include "state.h"
+#include "sampler.h"
 
 ///////////////////////////////////////
 
@@ -37,6 +39,11 @@
 #include <signal.h>
 #include <unistd.h>
 
+static volatile sig_atomic_t memory_requested = 0;
+static void memory_handler(int sig) {
+	memory_requested = 1; // reported from the main loop
+}
+
 static void error_handler(int sig) {
 	void *array[10];
 	size_t size;
@@ -54,611 +61,13 @@ static void error_handler(int sig) {
 
 ///////////////////////////////////////
 
-// NOTE: these are now case-insensitive!
-static int match_prefix(char* pre, char* str) {
-	return (strncasecmp(pre,str,strlen(pre))==0);
-}
-static int match_suffix(char* suf, char* str) {
-	int len = strlen(suf);
-	return (strncasecmp(suf, str+strlen(str)-len, len)==0);
-}
-// NOTE: this is still case-sensitive
-static int exact_match(char* str1, char* str2) {
-	int len1 = strlen(str1);
-	if (len1!=strlen(str2)) return 0;
-	return  (strncmp(str1,str2,len1)==0);
-}
-static void concat(char* str1, char* str2, int maxlen) {
-	int len1 = strlen(str1);
-	int len2 = strlen(str2);
-	if (len1+len2+1>maxlen) puts("concat overstepped its bounds"); // TODO: lock this down
-	strncpy(str1+len1, str2, len2);
-	str1[len1+len2] = 0;
-}
-static char* copy_string(char* str) {
-	int len = strlen(str);
-	char* copy = malloc(sizeof(char)*(len+1));
-	strcpy(copy, str);
-	copy[len] = '\0';
-	return copy;
-} // NOTE: caller must free() result!
-
-///////////////////////////////////////
-
-// only use to write single-line files!
-static void put_file(char* path, char* contents) {
-	FILE* file = fopen(path, "w");
-	fputs(contents, file);
-	fclose(file);
-}
-static void get_file(char* path, char* buffer) {
-	FILE *file = fopen(path, "r");
-	fseek(file, 0L, SEEK_END);
-	size_t size = ftell(file);
-	rewind(file);
-	fread(buffer, sizeof(char), size, file);
-	fclose(file);
-	buffer[size] = '\0';
-}
-
-///////////////////////////////////////
-
-static int hide(char* name) {
-	if (name[0]=='.') return 1;
-	
-	// TODO: these might not be necessary? unless a user just renames their stock folders...
-	if (match_suffix("_cache.db", name)) return 1;
-	if (match_prefix("COPYING", name)) return 1;
-	if (exact_match("license", name)) return 1;
-	if (exact_match("LICENSE", name)) return 1;
-
-	return 0;
-}
-
-///////////////////////////////////////
-
-typedef struct Array {
-	int count;
-	int capacity;
-	void** items;
-} Array;
-static Array* Array_new(void) {
-	Array* self = malloc(sizeof(Array));
-	self->count = 0;
-	self->capacity = 8;
-	self->items = malloc(sizeof(void*) * self->capacity);
-	return self;
-}
-static void Array_push(Array* self, void* item) {
-	if (self->count>=self->capacity) {
-		self->capacity *= 2;
-		self->items = realloc(self->items, sizeof(void*) * self->capacity);
-	}
-	self->items[self->count++] = item;
-}
-static void Array_unshift(Array* self, void* item) {
-	if (self->count==0) return Array_push(self, item);
-	Array_push(self, NULL); // ensures we have enough capacity
-	for (int i=self->count-2; i>=0; i--) {
-		self->items[i+1] = self->items[i];
-	}
-	self->items[0] = item;
-}
-static void* Array_pop(Array* self) {
-	if (self->count==0) return NULL;
-	return self->items[--self->count];
-} // NOTE: caller must free result (when appropriate)!
-static void Array_free(Array* self) {
-	free(self->items); // NOTE: caller is responsible for freeing individual items first!
-	free(self);
-}
-static void Array_reverse(Array* self) {
-	int end = self->count-1;
-	int mid = self->count/2;
-	for (int i=0; i<mid; i++) {
-		void* item = self->items[i];
-		self->items[i] = self->items[end-i];
-		self->items[end-i] = item;
-	}
-}
-
-///////////////////////////////////////
-
-static char* raw_name(char* path) {
-	char* tmp;
-	char name[256];
-	tmp = strrchr(path, '/')+1;
-	strcpy(name, tmp); // filename
-
-	tmp = strrchr(name, '.');
-	if (tmp!=NULL) tmp[0] = '\0'; // remove extension
-	
-	// remove trailing parens (round and square)
-	char safe[256];
-	strcpy(safe,name);
-	while ((tmp=strrchr(name, '('))!=NULL || (tmp=strrchr(name, '['))!=NULL) {
-		tmp[0] = '\0';
-		tmp = name;
-	}
-	// Trim trailing space
-	tmp = name+strlen(name)-1;
-    while(tmp>name && isspace((unsigned char)*tmp)) tmp--;
-    tmp[1] = '\0';
-	if (name[0]=='\0') strcpy(name,safe);
-	
-	// else concat(name, "/", 128);
-	return copy_string(name);
-} // NOTE: caller must free() result!
-
-static int index_char(char* str) {
-	char i = 0;
-	char c = tolower(str[0]);
-	if (c>='a' && c<='z') i = (c-'a')+1;
-	return i;
-}
-
-///////////////////////////////////////
-
-enum EntryType {
-	kEntryDir,
-	kEntryPak,
-	kEntryRom,
-};
-typedef struct Entry {
-	char* path;
-	char* name;
-	int type;
-	int alpha; // index in parent Directory's alphas Array, which points to the index of an Entry in its entries Array :sweat_smile:
-	int conflict;
-} Entry;
-
-static Entry* Entry_new(char* path, int type) {
-	Entry* self = malloc(sizeof(Entry));
-	self->type = type;
-	self->name = raw_name(path);
-	self->path = copy_string(path);
-	self->alpha = 0;
-	self->conflict = 0;
-	return self;
-}
-static void Entry_free(Entry* self) {
-	free(self->path);
-	free(self->name);
-	free(self);
-}
-
-static int EntryArray_indexOf(Array* self, char* path) {
-	for (int i=0; i<self->count; i++) {
-		Entry* entry = self->items[i];
-		if (exact_match(entry->path, path)) return i;
-	}
-	return -1;
-}
-static int EntryArray_sortEntry(const void* a, const void* b) {
-	Entry* item1 = *(Entry**)a;
-	Entry* item2 = *(Entry**)b;
-	return strcasecmp(item1->name, item2->name);
-}
-static void EntryArray_sort(Array* self) {
-	qsort(self->items, self->count, sizeof(void*), EntryArray_sortEntry);
-}
-
-static void EntryArray_free(Array* self) {
-	for (int i=0; i<self->count; i++) {
-		Entry_free(self->items[i]);
-	}
-	Array_free(self);
-}
-
-///////////////////////////////////////
-
-static int exists(char* path) {
-	return access(path, F_OK)==0;
-}
-
-static void StringArray_free(Array* self) {
-	for (int i=0; i<self->count; i++) {
-		free(self->items[i]);
-	}
-	Array_free(self);
-}
-static int StringArray_indexOf(Array* self, char* str) {
-	for (int i=0; i<self->count; i++) {
-		if (exact_match(self->items[i], str)) return i;
-	}
-	return -1;
-}
-
-#define kMaxRecents 40
-Array* recents;
-static void saveRecents(void) {
-	FILE* file = fopen(kRootDir "/.minui/recent.txt", "w");
-	if (file) {
-		for (int i=0; i<recents->count; i++) {
-			fputs(recents->items[i], file);
-			putc('\n', file);
-		}
-		fclose(file);
-	}
-}
-static void addRecent(char* path) {
-	int id = StringArray_indexOf(recents, path);
-	if (id==-1) { // add
-		while (recents->count>=kMaxRecents) {
-			free(Array_pop(recents));
-		}
-		Array_unshift(recents, copy_string(path));
-	}
-	else if (id>0) { // bump to top
-		for (int i=id; i>0; i--) {
-			void* tmp = recents->items[i-1];
-			recents->items[i-1] = recents->items[i];
-			recents->items[i] = tmp;
-		}
-	}
-	saveRecents();
-}
-static int hasRecents(void) {
-	int has = 0;
-	
-	Array* parent_paths = Array_new();
-	if (exists(kChangeDiscPath)) {
-		char disc_path[256];
-		get_file(kChangeDiscPath, disc_path);
-		if (exists(disc_path)) {
-			Array_push(recents, copy_string(disc_path));
-			
-			char parent_path[256];
-			strcpy(parent_path, disc_path);
-			char* tmp = strrchr(parent_path, '/') + 1;
-			tmp[0] = '\0';
-			Array_push(parent_paths, copy_string(parent_path));
-		}
-		unlink(kChangeDiscPath);
-	}
-	
-	FILE* file = fopen(kRootDir "/.minui/recent.txt", "r"); // newest at top
-	if (file) {
-		char line[256];
-		while (fgets(line,256,file)!=NULL) {
-			int len = strlen(line);
-			if (len>0 && line[len-1]=='\n') {
-				line[len-1] = 0; // trim newline
-				len -= 1;
-				if (len>0 && line[len-1]=='\r') {
-					line[len-1] = 0; // trim Windows newline
-					len -= 1;
-				}
-			}
-			if (len==0) continue; // skip empty lines
-			
-			if (exists(line)) {
-				has = 1;
-				if (recents->count<kMaxRecents) {
-					if (match_suffix(".cue", line)) {
-						char parent_path[256];
-						strcpy(parent_path, line);
-						char* tmp = strrchr(parent_path, '/') + 1;
-						tmp[0] = '\0';
-						
-						int found = 0;
-						for (int i=0; i<parent_paths->count; i++) {
-							char* path = parent_paths->items[i];
-							if (match_prefix(path, parent_path)) {
-								found = 1;
-								break;
-							}
-						}
-						if (found) continue;
-						
-						Array_push(parent_paths, copy_string(parent_path));
-					}
-					Array_push(recents, copy_string(line));
-				}
-			}
-		}
-		fclose(file);
-	}
-	
-	saveRecents();
-	
-	StringArray_free(parent_paths);
-	return has;
-}
-static int hasPaks(char* path) {
-	int has = 0;
-
-	DIR *dh = opendir(path);
-	if (dh!=NULL) {
-		struct dirent *dp;
-		while((dp = readdir(dh)) != NULL) {
-			int is_dir = dp->d_type==DT_DIR;
-			if (is_dir && match_suffix(".pak", dp->d_name)) {
-				char pak[256];
-				pak[0] = '\0';
-				concat(pak, path, 256);
-				concat(pak, "/", 256);
-				concat(pak, dp->d_name, 256);
-				concat(pak, "/launch.sh", 256);
-				if (exists(pak)) {
-					has = 1;
-					break;
-				}
-			}
-		}
-		closedir(dh);
-	}
-	return has;
-}
-static int hasRoms(char* path) {
-	int has = 0;
-	
-	// makes sure we have an emu pak
-	char emu[256];
-	strcpy(emu, path);
-	strncpy(emu, kEmusDir, strlen(kEmusDir));
-	concat(emu, ".pak/launch.sh", 256);
-	if (!exists(emu)) return has;
-	
-	// now look for at least one rom
-	DIR *dh = opendir(path);
-	if (dh!=NULL) {
-		struct dirent *dp;
-		while((dp = readdir(dh)) != NULL) {
-			if (hide(dp->d_name)) continue;
-			// if (dp->d_type==DT_DIR) continue;
-			has = 1;
-			break;
-		}
-		closedir(dh);
-	}
-	return has;
-}
-static int hasUpdate(void) {
-	int has = 0;
-	if (exists(kTrimuiUpdatePath)) {
-		struct stat st; 
-		if (stat(kTrimuiUpdatePath, &st)==0 && st.st_size>512) {
-			has = 1;
-		}
-	}
-	return has;
-}
-
-static Array* getRecents(void) {
-	Array* entries = Array_new();
-	for (int i=0; i<recents->count; i++) {
-		char* path = recents->items[i];
-		int type = match_suffix(".pak", path) ? kEntryPak : kEntryRom;
-		Array_push(entries, Entry_new(path, type));
-	}
-	return entries;
-}
-static Array* getEntries(char* path) {
-	Array* entries = Array_new();
-	DIR *dh = opendir(path);
-	if (dh!=NULL) {
-		struct dirent *dp;
-		char full_path[256];
-		full_path[0] = '\0';
-		concat(full_path, path, 256);
-		concat(full_path, "/", 256);
-		char* tmp = full_path + strlen(full_path);
-		while((dp = readdir(dh)) != NULL) {
-			if (hide(dp->d_name)) continue;
-			strcpy(tmp, dp->d_name);
-			tmp[strlen(dp->d_name)] = '\0';
-			int is_dir = dp->d_type==DT_DIR;
-			int type;
-			if (is_dir) {
-				if (match_suffix(".pak", dp->d_name)) {
-					type = kEntryPak;
-				}
-				else {
-					type = kEntryDir;
-				}
-			}
-			else {
-				type = kEntryRom;
-			}
-			Array_push(entries, Entry_new(full_path, type));
-		}
-		closedir(dh);
-	}
-	EntryArray_sort(entries);
-	return entries;
-}
-static int has_roms = 0;
-static Array* getRoot(void) {
-	Array* entries = Array_new();
-
-	int has_recents = hasRecents();
-	int has_games = hasPaks(kRootDir "/Games");
-	int has_tools = hasPaks(kRootDir "/Tools");
-	int has_update = hasUpdate();
-	
-	if (has_recents) Array_push(entries, Entry_new(kRecentlyPlayedDir, kEntryDir));
-	
-	char* path = kRootDir "/Roms";
-	DIR *dh = opendir(path);
-	if (dh!=NULL) {
-		struct dirent *dp;
-		char full_path[256];
-		full_path[0] = '\0';
-		concat(full_path, path, 256);
-		concat(full_path, "/", 256);
-		char* tmp = full_path + strlen(full_path);
-		Array* emus = Array_new();
-		while((dp = readdir(dh)) != NULL) {
-			if (hide(dp->d_name)) continue;
-			strcpy(tmp, dp->d_name);
-			tmp[strlen(dp->d_name)] = '\0';
-			
-			if (hasRoms(full_path)) {
-				Array_push(emus, Entry_new(full_path, kEntryDir));
-				has_roms = 1;
-			}
-		}
-		EntryArray_sort(emus);
-		for (int i=0; i<emus->count; i++) {
-			Array_push(entries, emus->items[i]);
-		}
-		Array_free(emus); // just free the array part, root now owns emus entries
-		closedir(dh);
-	}
-	
-	if (has_games) Array_push(entries, Entry_new(kRootDir "/Games", kEntryDir));
-	if (has_tools) Array_push(entries, Entry_new(kRootDir "/Tools", kEntryDir));
-	if (has_update) Array_push(entries, Entry_new(kRootDir "/System/Update.pak", kEntryPak));
-	
-	return entries;
-}
-static Array* getDiscs(char* path) {
-	Array* entries = Array_new();
-	
-	char base_path[256];
-	strcpy(base_path, path);
-	char* tmp = strrchr(base_path, '/') + 1;
-	tmp[0] = '\0';
-	
-	// TODO: limit number of discs supported (to 9?)
-	FILE* file = fopen(path, "r");
-	if (file) {
-		char line[256];
-		int disc = 0;
-		while (fgets(line,256,file)!=NULL) {
-			int len = strlen(line);
-			if (len>0 && line[len-1]=='\n') {
-				line[len-1] = 0; // trim newline
-				len -= 1;
-				if (len>0 && line[len-1]=='\r') {
-					line[len-1] = 0; // trim Windows newline
-					len -= 1;
-				}
-			}
-			if (len==0) continue; // skip empty lines
-			
-			char disc_path[256];
-			strcpy(disc_path, base_path);
-			concat(disc_path, line, 256);
-						
-			if (exists(disc_path)) {
-				disc += 1;
-				Entry* entry = Entry_new(disc_path, kEntryRom);
-				free(entry->name);
-				char name[16];
-				sprintf(name, "Disc %i", disc);
-				entry->name = copy_string(name);
-				Array_push(entries, entry);
-			}
-		}
-		fclose(file);
-	}
-	return entries;
-}
-
-///////////////////////////////////////
-
-#define kIntArrayMax 27
-typedef struct IntArray {
-	int count;
-	int items[kIntArrayMax];
-} IntArray;
-static IntArray* IntArray_new(void) {
-	IntArray* self = malloc(sizeof(IntArray));
-	self->count = 0;
-	self->items[0] = 0; // TODO: zero all entries?
-	return self;
-}
-static void IntArray_push(IntArray* self, int i) {
-	if (self->count==kIntArrayMax) {
-		puts("IntArray items exceeded kIntArrayMax");
-		return;
-	}
-	self->items[self->count++] = i;
-}
-static void IntArray_free(IntArray* self) {
-	free(self);
-}
-
-///////////////////////////////////////
-
-typedef struct Directory {
-	char* path;
-	Array* entries;
-	IntArray* alphas;
-	// rendering
-	int selected;
-	int start;
-	int end;
-} Directory;
-
-static void Directory_index(Directory* self) {
-	Entry* prior = NULL;
-	int alpha = -1;
-	int index = 0;
-	for (int i=0; i<self->entries->count; i++) {
-		Entry* entry = self->entries->items[i];
-		if (prior!=NULL && exact_match(prior->name, entry->name)) {
-			prior->conflict = 1;
-			entry->conflict = 1;
-		}
-		int a = index_char(entry->name);
-		if (a!=alpha) {
-			index = self->alphas->count;
-			IntArray_push(self->alphas, i);
-			alpha = a;
-		}
-		entry->alpha = index;
-		
-		prior = entry;
-	}
-}
-
-static Directory* Directory_new(char* path, int selected) {
-	Directory* self = malloc(sizeof(Directory));
-	self->path = copy_string(path);
-	if (exact_match(path, kRootDir)) {
-		self->entries = getRoot();
-	}
-	else if (exact_match(path, kRecentlyPlayedDir)) {
-		self->entries = getRecents();
-	}
-	else if (match_suffix(".m3u", path)) {
-		self->entries = getDiscs(path);
-	}
-	else {
-		self->entries = getEntries(path);
-	}
-	self->alphas = IntArray_new();
-	self->selected = selected;
-	Directory_index(self);
-	return self;
-}
-static void Directory_free(Directory* self) {
-	free(self->path);
-	EntryArray_free(self->entries);
-	IntArray_free(self->alphas);
-	free(self);
-}
-
-static void DirectoryArray_pop(Array* self) {
-	Directory_free(Array_pop(self));
-}
-static void DirectoryArray_free(Array* self) {
-	for (int i=0; i<self->count; i++) {
-		Directory_free(self->items[i]);
-	}
-	Array_free(self);
-}
-
-///////////////////////////////////////
-
 typedef struct ButtonState {
 	int justPressed;
-	int justRepeated;
+	int justRepeated; // steps to move this frame, presses and every repeat that came due
 	int isPressed;
 	int justReleased;
+	unsigned long pressed_at;
+	unsigned long repeat_at; // when the next repeat is due
 } ButtonState;
 enum {
 	TRIMUI_UP 		= SDLK_UP,
@@ -709,6 +118,59 @@ static void Input_reset(void) {
 		buttons[i].justRepeated = 0;
 	}
 }
+
+// MinUI does its own key repeat, SDL's fixed 300ms/100ms takes minutes to cross a big folder
+// the longer a button is held the sooner it repeats and the further each direction repeat moves
+typedef struct RepeatStage {
+	unsigned long held; // ms since the press
+	unsigned long interval; // ms until the next repeat
+	int steps; // per direction repeat
+} RepeatStage;
+static RepeatStage repeat_stages[] = {
+	{   0, 300,  1}, // delay before the first repeat
+	{ 300, 100,  1},
+	{1500,  50,  1},
+	{3000,  33,  4},
+	{5000,  33, 16},
+	{7000,  33, 64},
+};
+#define kRepeatStageCount (sizeof(repeat_stages)/sizeof(repeat_stages[0]))
+
+static RepeatStage* Input_getRepeatStage(unsigned long held) {
+	int i = kRepeatStageCount-1;
+	while (i>0 && held<repeat_stages[i].held) i -= 1;
+	return &repeat_stages[i];
+}
+static void Input_press(int btn, unsigned long now) {
+	ButtonState* button = &buttons[btn];
+	button->justRepeated += 1;
+	button->justPressed = 1;
+	button->isPressed = 1;
+	button->pressed_at = now;
+	button->repeat_at = now + repeat_stages[0].interval;
+}
+// sums every repeat that came due since the last poll into justRepeated so a slow frame
+// still moves as far, returns the last button that repeated or kButtonNull
+static int Input_repeat(unsigned long now) {
+	int repeated = kButtonNull;
+	for (int i=0; i<kButtonCount; i++) {
+		ButtonState* button = &buttons[i];
+		if (!button->isPressed) continue;
+		while ((long)(now-button->repeat_at)>=0) {
+			RepeatStage* stage = Input_getRepeatStage(button->repeat_at-button->pressed_at);
+			button->justRepeated += i<=kButtonRight ? stage->steps : 1;
+			button->repeat_at += stage->interval;
+			repeated = i;
+		}
+	}
+	return repeated;
+}
+static int Input_isRepeating(unsigned long now) { // a direction is held past its first repeat
+	for (int i=kButtonUp; i<=kButtonRight; i++) {
+		if (buttons[i].isPressed && now-buttons[i].pressed_at>=repeat_stages[1].held) return 1;
+	}
+	return 0;
+}
 #define Input_justPressed(btn) buttons[(btn)].justPressed
 #define Input_justRepeated(btn) buttons[(btn)].justRepeated
 #define Input_isPressed(btn) buttons[(btn)].isPressed
@@ -734,6 +196,19 @@ static int Input_getButton(SDL_Event *event) {
 
 ///////////////////////////////////////
 
+static const KeyShm* keyshm = NULL; // published by keymon, NULL when keymon isn't running
+static PowerStats power; // opt-in, see powerstats.h
+
+static int getSetting(int setting) { // 1=brightness,2=volume
+	KeyShm keys;
+	if (keyshm && KeyShm_read(keyshm, &keys)) {
+		return setting==1 ? keys.brightness : keys.volume;
+	}
+	return setting==1 ? GetBrightness() : GetVolume();
+}
+
+///////////////////////////////////////
+
 SDL_Surface* screen;
 int quit = 0;
 
@@ -770,6 +245,53 @@ static void setCPU(uint32_t mhz) {
 	if (memdev>0) close(memdev);
 }
 
+// launch profiles, the first of these that exists names the clock a rom runs at:
+// Roms/<emu>/.cpu/<rom>.txt, Roms/<emu>/.cpu/default.txt, Emus/<emu>.pak/cpu.txt
+
+typedef struct CPUProfile {
+	char* name;
+	uint32_t value;
+} CPUProfile;
+static CPUProfile cpu_profiles[] = {
+	{"low", kCPULow},
+	{"normal", kCPUNormal},
+	{"high", kCPUHigh},
+	{NULL, 0},
+};
+
+static CPUProfile* getCPUProfile(char* path) { // NULL if path doesn't exist or names no profile
+	FILE* file = fopen(path, "r");
+	if (!file) return NULL;
+	char name[32];
+	if (!fgets(name, sizeof(name), file)) name[0] = '\0';
+	fclose(file);
+	name[strcspn(name, " \t\r\n")] = '\0';
+	for (CPUProfile* profile=cpu_profiles; profile->name; profile++) {
+		if (!strcasecmp(name, profile->name)) return profile;
+	}
+	return NULL;
+}
+static void applyCPUProfile(char* emu_name, char* rom_path) {
+	char* rom_file = strrchr(rom_path, '/') + 1;
+	char paths[3][256];
+	sprintf(paths[0], "%s%s/.cpu/%s", kRomsDir, emu_name, rom_file);
+	char* tmp = strrchr(paths[0], '.');
+	if (tmp>strrchr(paths[0], '/')) *tmp = '\0';
+	concat(paths[0], ".txt", 256);
+	sprintf(paths[1], "%s%s/.cpu/default.txt", kRomsDir, emu_name);
+	sprintf(paths[2], "%s%s.pak/cpu.txt", kEmusDir, emu_name);
+	
+	CPUProfile* profile = NULL;
+	char* source = "none";
+	for (int i=0; i<3 && !profile; i++) {
+		profile = getCPUProfile(paths[i]);
+		if (profile) source = paths[i];
+	}
+	if (profile && profile->value!=kCPUNormal) setCPU(profile->value); // MinUI restores kCPUNormal on return
+	
+	printf("cpu: %s: %s (%s)\n", rom_file, profile ? profile->name : "normal", source); // lands in logring's MinUI log
+}
+
 static void initLCD(void) {
 	int address = 0x01c20890;
 	int pagesize = sysconf(_SC_PAGESIZE);
@@ -784,8 +306,53 @@ static void initLCD(void) {
 	close(memhandle);
 }
 
+static void signalKeymon(int sig) {
+	FILE* file = fopen(KEYMON_PID_PATH, "r");
+	if (!file) return;
+	int pid = 0;
+	if (fscanf(file, "%i", &pid)==1 && pid>0) kill(pid, sig);
+	fclose(file);
+}
+
+static int openInput(void) { // the gpio_keys evdev device keymon reads, -1 if there isn't one
+	char path[64];
+	char name[32];
+	for (int i=0; i<10; i++) {
+		snprintf(path, sizeof(path), "/sys/class/input/event%d/device/name", i);
+		FILE* file = fopen(path, "r");
+		if (!file) continue;
+		int found = fgets(name, sizeof(name), file) && !strncmp(name, "gpio_keys", 9);
+		fclose(file);
+		if (!found) continue;
+		snprintf(path, sizeof(path), "/dev/input/event%d", i);
+		return open(path, O_RDONLY);
+	}
+	return -1;
+}
+
 static void waitForWakeCombo(void) {
 	SDL_Event event;
+	int fd = openInput();
+	if (fd>=0) {
+		// block in read() so nothing runs until a button does and wake is immediate
+		struct input_event ev;
+		int L = 0;
+		int R = 0;
+		int wake = 0;
+		while (!wake && read(fd, &ev, sizeof(ev))==sizeof(ev)) {
+			if (ev.type!=EV_KEY || ev.value==2) continue; // ignore repeats
+			if (ev.code==KEY_TAB) L = ev.value; // TRIMUI_L
+			else if (ev.code==KEY_BACKSPACE) R = ev.value; // TRIMUI_R
+			else if (ev.value && L && R) wake = 1; // any face button
+		}
+		close(fd);
+		
+		// SDL queued the same presses, don't let the combo act on the menu
+		while (SDL_PollEvent(&event));
+		return;
+	}
+	
+	// no evdev device, drain SDL's queue once a second
 	int L = 0;
 	int R = 0;
 	int wake = 0;
@@ -810,30 +377,40 @@ static void waitForWakeCombo(void) {
 	}
 }
 
+static void setPowerState(int state) {
+	if (state!=power.state) PowerStats_publish(&power, state); // for keymon
+	PowerStats_update(&power, state);
+}
+
 static void fauxSleep(void) {
+	setPowerState(POWER_SLEEP);
 	SetRawVolume(0);
 	SetRawBrightness(0);
 	setCPU(kCPUDead);
 	
-	system("killall -s STOP keymon");
+	signalKeymon(SIGSTOP);
 	
 	waitForWakeCombo();
 	
-	system("killall -s CONT keymon");
+	signalKeymon(SIGCONT);
 
 	SetVolume(GetVolume());
 	SetBrightness(GetBrightness());
 	setCPU(kCPUNormal);
+	setPowerState(POWER_BROWSING);
 }
 
 ///////////////////////////////////////
 
-static void restoreSettings(void) {
+static void reapplySettings(void) { // after anything else may have touched the hardware
 	initLCD();
-	InitSettings();
 	SetVolume(GetVolume());
 	SetBrightness(GetBrightness());
 }
+static void restoreSettings(void) {
+	InitSettings();
+	reapplySettings();
+}
 static int getBatteryLevel(void) {
 	// returns the average of the last 10 readings
 	#define kBatteryReadings 10
@@ -902,10 +479,26 @@ static void saveLast(char* path) {
 
 static void queue_next(char* cmd) {
 	// queue up next command
-	put_file(kRootDir "/.minui/next.sh", cmd);
+	put_file(kNextPath, cmd);
+	State_commit(); // the recents this launch changed, durable before the pak runs
 	quit = 1;
 }
 
+// opt-in resident mode, enable with .minui/enable-resident
+// instead of exiting to let System.pak eval next.sh, MinUI runs a rom's launch.sh itself
+// and hands the display back and forth so returning to the menu takes one frame
+static int enable_resident = 0;
+static int resident_pending = 0; // picked up by the main loop, see Resident_run()
+static char resident_cmd[512];
+static char resident_name[256];
+
+static void queue_resident(char* cmd, char* emu_name) {
+	strcpy(resident_cmd, cmd);
+	strcpy(resident_name, emu_name);
+	State_commit(); // the recents this launch changed, durable before the pak runs
+	resident_pending = 1;
+}
+
 static int has_cue(char* path, char* auto_path) {
 	char* tmp = strrchr(path, '/') + 1; // folder name
 	strcpy(auto_path, path);
@@ -916,19 +509,18 @@ static int has_cue(char* path, char* auto_path) {
 	return 0;
 }
 
-static int can_resume = 0;
-static int should_resume = 0; // set to 1 on TRIMUI_START but only if can_resume==1
+static int should_resume = 0; // set to 1 on TRIMUI_X but only if the selection can be resumed
 static char slot_path[256];
 
-static void ready_resume(Entry* entry) {
-	can_resume = 0;
+// NOTE: runs on the render thread, see Render_canResume()
+static int ready_resume(char* entry_path, int type, char* slot_path) {
 	char path[256];
-	strcpy(path, entry->path);
-	if (!match_prefix(kRomsDir, path)) return;
+	strcpy(path, entry_path);
+	if (!match_prefix(kRomsDir, path)) return 0;
 	
 	char auto_path[256];
-	if (entry->type==kEntryDir) {
-		if (!has_cue(path, auto_path)) return;
+	if (type==kEntryDir) {
+		if (!has_cue(path, auto_path)) return 0;
 		strcpy(path, auto_path);
 	}
 	
@@ -951,11 +543,11 @@ static void ready_resume(Entry* entry) {
 	tmp = strrchr(slot_path, '.') + 1;
 	strcpy(tmp, "txt");
 	
-	can_resume = exists(slot_path);
+	return exists(slot_path);
 }
 	
 static void open_rom(char* path, char* last) {
-	char launch[256];
+	char launch[512];
 	launch[0] = '"';
 	strcpy(launch+1, kEmusDir);
 
@@ -971,13 +563,22 @@ static void open_rom(char* path, char* last) {
 		should_resume = 0;
 	}
 	
-	concat(launch, emu_name, 256);
-	concat(launch, ".pak/launch.sh\" \"", 256);
-	concat(launch, path, 256);
-	concat(launch, "\"", 256);
+	concat(launch, emu_name, 512);
+	concat(launch, ".pak/launch.sh\" \"", 512);
+	if (match_suffix(".zip", path)) {
+		// swapped for an extracted copy from .minui/romcache when next.sh is eval'd
+		concat(launch, "$(romcache \"", 512);
+		concat(launch, path, 512);
+		concat(launch, "\")", 512);
+	}
+	else concat(launch, path, 512);
+	concat(launch, "\"", 512);
 	addRecent(path);
 	saveLast(last==NULL ? path : last);
-	queue_next(launch);
+	applyCPUProfile(emu_name, path);
+	Timeline_mark("queue_next", emu_name);
+	if (enable_resident) queue_resident(launch, emu_name);
+	else queue_next(launch);
 }
 static void open_pak(char*path) {
 	char launch[256];
@@ -988,6 +589,7 @@ static void open_pak(char*path) {
 		addRecent(path);
 	}
 	saveLast(path);
+	Timeline_mark("queue_next", strrchr(path, '/')+1);
 	queue_next(launch);
 }
 
@@ -1036,15 +638,42 @@ static void close_directory(void) {
 	restore_relative = top->selected;
 }
 
+static void markPress(int btn) {
+	// prefer keymon's evdev timestamp when it shares our clock and is for this press,
+	// a keymon that missed it (stopped or restarting) still holds an earlier one
+	int64_t at = 0;
+	KeyShm keys;
+	if (keyshm && KeyShm_read(keyshm, &keys) && keys.clock==CLOCK_MONOTONIC) {
+		int64_t now = Timeline_now();
+		at = keys.pressed_at[btn];
+		if (at>now || now-at>=KEYSHM_MAX_AGE) at = 0;
+	}
+	Timeline_markAt("press", NULL, at);
+}
+
+static void prewarm_selected(void) {
+	Entry* entry = top->entries->items[top->selected];
+	char path[256];
+	char rom_path[256];
+	rom_path[0] = '\0';
+	if (match_prefix(kRomsDir, Entry_getPath(entry, path))) {
+		if (entry->type==kEntryRom) strcpy(rom_path, path);
+		else if (entry->type==kEntryDir && !has_cue(path, rom_path)) rom_path[0] = '\0';
+	}
+	Prewarm_select(rom_path);
+}
+
 static void Entry_open(Entry* self) {
+	char path[256];
+	Entry_getPath(self, path);
 	if (self->type==kEntryRom) {
-		open_rom(self->path, NULL);
+		open_rom(path, NULL);
 	}
 	else if (self->type==kEntryPak) {
-		open_pak(self->path);
+		open_pak(path);
 	}
 	else if (self->type==kEntryDir) {
-		open_directory(self->path, 1);
+		open_directory(path, 1);
 	}
 }
 
@@ -1064,24 +693,22 @@ static void loadLast(void) { // call after loading root directory
 	
 	while (last->count>0) {
 		char* path = Array_pop(last);
-		for (int i=0; i<top->entries->count; i++) {
+		int i = Directory_indexOf(top, path);
+		if (i>=0) {
 			Entry* entry = top->entries->items[i];
-			if (exact_match(entry->path, path)) {
-				top->selected = i;
-				if (i>=top->end) {
-					top->start = i;
-					top->end = top->start + kMaxRows;
-					if (top->end>top->entries->count) {
-						top->end = top->entries->count;
-						top->start = top->end - kMaxRows;
-					}
-				}
-				if (last->count==0 && !exact_match(entry->path, kRecentlyPlayedDir)) break; // don't show contents of auto-launch dirs
-				
-				if (entry->type==kEntryDir) {
-					open_directory(entry->path, 0);
+			top->selected = i;
+			if (i>=top->end) {
+				top->start = i;
+				top->end = top->start + kMaxRows;
+				if (top->end>top->entries->count) {
+					top->end = top->entries->count;
+					top->start = top->end - kMaxRows;
 				}
 			}
+			// don't show contents of auto-launch dirs
+			if (entry->type==kEntryDir && (last->count>0 || exact_match(path, kRecentlyPlayedDir))) {
+				open_directory(path, 0);
+			}
 		}
 		free(path); // we took ownership when we popped it
 	}
@@ -1099,6 +726,7 @@ static void Menu_init(void) {
 static void Menu_quit(void) {
 	StringArray_free(recents);
 	DirectoryArray_free(stack);
+	Path_quit();
 }
 
 static int enable_screenshots = 0;
@@ -1106,11 +734,8 @@ static int screenshots = 0;
 static void load_screenshots(void) {
 	enable_screenshots = exists(kRootDir "/.minui/enable-screenshots");
 	if (!enable_screenshots) return;
-	if (exists(kScreenshotsPath)) {
-		char tmp[16];
-		get_file(kScreenshotsPath, tmp);
-		screenshots = atoi(tmp);
-	}
+	char* saved = State_get(kStateScreenshots);
+	if (saved) screenshots = atoi(saved);
 }
 static void save_screenshot(SDL_Surface* surface) {
 	if (!enable_screenshots) return;
@@ -1121,13 +746,814 @@ static void save_screenshot(SDL_Surface* surface) {
 	SDL_SaveBMP_RW(surface ? surface : screen, out, 1);
 	char count[16];
 	sprintf(count, "%i", screenshots);
-	put_file(kScreenshotsPath, count);
+	State_set(kStateScreenshots, count);
+	State_commit();
+}
+
+///////////////////////////////////////
+
+// opt-in input-to-photon tracing, enable with .minui/enable-latency
+// each button press is timestamped by keymon (evdev time) and followed through
+// SDL delivery, the state update, rendering and SDL_Flip()
+
+#define kLatencyPath kRootDir "/.minui/logs/latency.txt"
+#define kLatencyBuckets 12 // <1ms, <2ms, <4ms ... >=1024ms
+
+enum {
+	kLatencyDeliver, // evdev -> SDL_PollEvent
+	kLatencyUpdate, // -> navigation done and the view published
+	kLatencyRender, // -> view picked up, drawn and blitted by the render thread
+	kLatencyFlip, // -> SDL_Flip() returned
+	kLatencyTotal, // evdev -> SDL_Flip() returned
+	kLatencyStageCount,
+};
+static char* latency_names[kLatencyStageCount] = {
+	"deliver",
+	"update",
+	"render",
+	"flip",
+	"total",
+};
+
+typedef struct LatencyStats {
+	int count;
+	int64_t sum;
+	int64_t max;
+	int buckets[kLatencyBuckets];
+} LatencyStats;
+
+typedef struct LatencyTrace {
+	int64_t origin; // 0 when nothing is pending
+	int64_t marks[kLatencyStageCount];
+} LatencyTrace;
+
+static int enable_latency = 0;
+static int latency_clock = CLOCK_MONOTONIC; // matches keymon's evdev clock when available
+static int latency_keymon = 0; // 1 when origins come from keymon, 0 when from SDL delivery
+static LatencyTrace latency_pending; // input thread, handed off with the next published view
+static LatencyStats latency_stats[kLatencyStageCount]; // render thread
+
+static void Latency_init(void) {
+	enable_latency = exists(kRootDir "/.minui/enable-latency");
+	if (!enable_latency) return;
+	
+	KeyShm keys;
+	if (keyshm && KeyShm_read(keyshm, &keys)) {
+		latency_clock = keys.clock;
+		latency_keymon = 1;
+	}
+}
+static void Latency_event(int btn, int is_repeat) { // call as each button event is polled
+	if (!enable_latency || latency_pending.origin) return; // only trace the oldest unpresented event
+	
+	int64_t now = KeyShm_now(latency_clock);
+	int64_t origin = now;
+	KeyShm keys;
+	// NOTE: keymon doesn't publish repeats so those are timed from when Input_repeat() made them
+	if (!is_repeat && latency_keymon && KeyShm_read(keyshm, &keys)) {
+		int64_t pressed_at = keys.pressed_at[btn];
+		// SDL can beat keymon to the event, in which case pressed_at is a stale earlier press
+		if (pressed_at<=now && now-pressed_at<KEYSHM_MAX_AGE) origin = pressed_at;
+	}
+	
+	latency_pending.origin = origin;
+	latency_pending.marks[kLatencyDeliver] = now;
+}
+static void Latency_mark(LatencyTrace* trace, int stage) {
+	if (!enable_latency || !trace->origin) return;
+	trace->marks[stage] = KeyShm_now(latency_clock);
+}
+static void Latency_handoff(LatencyTrace* trace) { // moves the pending trace into a view being published
+	*trace = latency_pending;
+	memset(&latency_pending, 0, sizeof(LatencyTrace));
+}
+static void LatencyStats_add(LatencyStats* self, int64_t us) {
+	if (us<0) us = 0;
+	int bucket = 0;
+	int64_t ms = us / 1000;
+	while (ms>0 && bucket<kLatencyBuckets-1) {
+		ms >>= 1;
+		bucket += 1;
+	}
+	self->count += 1;
+	self->sum += us;
+	if (us>self->max) self->max = us;
+	self->buckets[bucket] += 1;
+}
+static void Latency_flip(LatencyTrace* trace) { // call after SDL_Flip()
+	if (!enable_latency || !trace->origin) return;
+	
+	int64_t* marks = trace->marks;
+	marks[kLatencyFlip] = KeyShm_now(latency_clock);
+	marks[kLatencyTotal] = marks[kLatencyFlip];
+	
+	int64_t prior = trace->origin;
+	for (int i=0; i<kLatencyTotal; i++) {
+		// a stage that wasn't marked this frame took no time
+		if (marks[i]<prior) marks[i] = prior;
+		LatencyStats_add(&latency_stats[i], marks[i]-prior);
+		prior = marks[i];
+	}
+	LatencyStats_add(&latency_stats[kLatencyTotal], marks[kLatencyTotal]-trace->origin);
+	
+	memset(trace, 0, sizeof(LatencyTrace));
+}
+static void Latency_cancel(LatencyTrace* trace) { // input that didn't change anything on screen
+	memset(trace, 0, sizeof(LatencyTrace));
+}
+static void Latency_quit(void) {
+	if (!enable_latency) return;
+	
+	FILE* file = fopen(kLatencyPath, "w");
+	if (!file) return;
+	
+	fprintf(file, "input-to-photon latency (origin: %s)\n\n", latency_keymon ? "keymon evdev timestamp" : "SDL event delivery");
+	fprintf(file, "%-8s %6s %8s %8s", "stage", "count", "mean", "max");
+	for (int i=0; i<kLatencyBuckets; i++) {
+		char label[8];
+		if (i<kLatencyBuckets-1) sprintf(label, "<%i", 1<<i);
+		else sprintf(label, ">=%i", 1<<(i-1));
+		fprintf(file, " %6s", label);
+	}
+	fputs(" (ms)\n", file);
+	
+	for (int i=0; i<kLatencyStageCount; i++) {
+		LatencyStats* stats = &latency_stats[i];
+		double mean = stats->count ? (double)stats->sum / stats->count / 1000.0 : 0;
+		fprintf(file, "%-8s %6i %8.2f %8.2f", latency_names[i], stats->count, mean, stats->max / 1000.0);
+		for (int j=0; j<kLatencyBuckets; j++) {
+			fprintf(file, " %6i", stats->buckets[j]);
+		}
+		fputc('\n', file);
+	}
+	fclose(file);
+}
+
+///////////////////////////////////////
+
+// opt-in frame profiler, enable with .minui/enable-profiler
+// touch .minui/enable-profiler-overlay to also draw the last frame's timings on screen
+
+#define kProfilerPath kRootDir "/.minui/logs/profile.txt"
+#define kProfilerSamples 4096 // most recent drawn frames kept for percentiles
+
+// input, nav and frame are timed on the input thread and handed off with each published view,
+// the rest are timed on the render thread as it presents that view
+enum {
+	kProfileInput, // SDL_PollEvent loop
+	kProfileNav, // selection, open and close
+	kProfileResume, // ready_resume() probes
+	kProfileText, // TTF rendering
+	kProfileBlit, // everything else drawn before the flip
+	kProfileFlip, // SDL_Flip()
+	kProfileFrame, // the input thread's frame up to publishing plus drawing and presenting
+	kProfilePhaseCount,
+};
+static char* profile_names[kProfilePhaseCount] = {
+	"input",
+	"nav",
+	"resume",
+	"text",
+	"blit",
+	"flip",
+	"frame",
+};
+
+static int enable_profiler = 0;
+static int enable_profiler_overlay = 0;
+static int profiler_count = 0; // presented views recorded, wraps kProfilerSamples
+static int profiler_idle = 0; // input frames that didn't publish anything
+static uint32_t profiler_samples[kProfilePhaseCount][kProfilerSamples]; // microseconds
+static uint32_t profiler_frame[kProfilePhaseCount]; // accumulating for the current frame
+static int64_t profiler_start[kProfilePhaseCount];
+
+static void Profiler_init(void) {
+	enable_profiler_overlay = exists(kRootDir "/.minui/enable-profiler-overlay");
+	enable_profiler = enable_profiler_overlay || exists(kRootDir "/.minui/enable-profiler");
+}
+static void Profiler_begin(int phase) {
+	if (!enable_profiler) return;
+	profiler_start[phase] = Timeline_now();
+}
+static void Profiler_end(int phase) {
+	if (!enable_profiler) return;
+	profiler_frame[phase] += Timeline_now() - profiler_start[phase];
+}
+static void Profiler_handoff(uint32_t* profile) { // input thread, moves its share of the frame into a view being published
+	if (!enable_profiler) return;
+	Profiler_end(kProfileFrame);
+	
+	profile[kProfileInput] = profiler_frame[kProfileInput];
+	profile[kProfileNav] = profiler_frame[kProfileNav];
+	profile[kProfileFrame] = profiler_frame[kProfileFrame];
+	profiler_frame[kProfileInput] = 0;
+	profiler_frame[kProfileNav] = 0;
+	profiler_frame[kProfileFrame] = 0;
+	
+	Profiler_begin(kProfileFrame); // the rest of this frame isn't part of the view
+}
+static void Profiler_endInput(int published) { // input thread, at the end of every frame
+	if (!enable_profiler) return;
+	if (!published) profiler_idle += 1;
+	
+	profiler_frame[kProfileInput] = 0;
+	profiler_frame[kProfileNav] = 0;
+	profiler_frame[kProfileFrame] = 0;
+}
+static void Profiler_endRender(uint32_t* profile, int64_t start) { // render thread, after presenting a view
+	if (!enable_profiler) return;
+	
+	uint32_t sample[kProfilePhaseCount];
+	sample[kProfileInput] = profile[kProfileInput];
+	sample[kProfileNav] = profile[kProfileNav];
+	sample[kProfileResume] = profiler_frame[kProfileResume];
+	sample[kProfileText] = profiler_frame[kProfileText];
+	sample[kProfileBlit] = profiler_frame[kProfileBlit];
+	sample[kProfileFlip] = profiler_frame[kProfileFlip];
+	sample[kProfileFrame] = profile[kProfileFrame] + (Timeline_now() - start);
+	
+	// text is timed inside the blit phase
+	if (sample[kProfileBlit]>sample[kProfileText]) sample[kProfileBlit] -= sample[kProfileText];
+	else sample[kProfileBlit] = 0;
+	
+	int i = profiler_count % kProfilerSamples;
+	for (int phase=0; phase<kProfilePhaseCount; phase++) {
+		profiler_samples[phase][i] = sample[phase];
+	}
+	profiler_count += 1;
+	
+	profiler_frame[kProfileResume] = 0;
+	profiler_frame[kProfileText] = 0;
+	profiler_frame[kProfileBlit] = 0;
+	profiler_frame[kProfileFlip] = 0;
+}
+static void Profiler_drawOverlay(SDL_Surface* surface, Font* font) {
+	if (!enable_profiler_overlay || !profiler_count) return;
+	
+	int i = (profiler_count-1) % kProfilerSamples;
+	char frame[16];
+	char phases[48];
+	sprintf(frame, "%.1fms", profiler_samples[kProfileFrame][i] / 1000.0);
+	sprintf(phases, "t%.1f b%.1f f%.1f", 
+		profiler_samples[kProfileText][i] / 1000.0,
+		profiler_samples[kProfileBlit][i] / 1000.0,
+		profiler_samples[kProfileFlip][i] / 1000.0
+	);
+	
+	// two lines in the bottom bar between the SLEEP/RESUME hint and the B button, the list runs right down to it
+	int cx = 139;
+	SDL_Color color = {0x66,0x66,0x66};
+	Font_draw(font, frame, color, surface, cx-Font_width(font, frame)/2, 203, 0, 0);
+	Font_draw(font, phases, color, surface, cx-Font_width(font, phases)/2, 217, 0, 0);
+}
+static int Profiler_sortSample(const void* a, const void* b) {
+	uint32_t sample1 = *(uint32_t*)a;
+	uint32_t sample2 = *(uint32_t*)b;
+	return (sample1>sample2) - (sample1<sample2);
+}
+static void Profiler_quit(void) {
+	if (!enable_profiler) return;
+	
+	FILE* file = fopen(kProfilerPath, "w");
+	if (!file) return;
+	
+	int count = profiler_count<kProfilerSamples ? profiler_count : kProfilerSamples;
+	fprintf(file, "presented views: %i (last %i sampled)\nidle input frames: %i\n\n", profiler_count, count, profiler_idle);
+	fprintf(file, "%-8s %8s %8s %8s %8s (ms)\n", "phase", "p50", "p95", "p99", "max");
+	
+	if (count) {
+		uint32_t* sorted = malloc(sizeof(uint32_t) * count);
+		for (int phase=0; phase<kProfilePhaseCount; phase++) {
+			memcpy(sorted, profiler_samples[phase], sizeof(uint32_t) * count);
+			qsort(sorted, count, sizeof(uint32_t), Profiler_sortSample);
+			fprintf(file, "%-8s %8.2f %8.2f %8.2f %8.2f\n", profile_names[phase],
+				sorted[(count-1) * 50 / 100] / 1000.0,
+				sorted[(count-1) * 95 / 100] / 1000.0,
+				sorted[(count-1) * 99 / 100] / 1000.0,
+				sorted[count-1] / 1000.0
+			);
+		}
+		free(sorted);
+	}
+	fclose(file);
+}
+
+static void drawText(Font* font, char* str, SDL_Color color, int x, int y, int ox, int max_w) {
+	Profiler_begin(kProfileText);
+	Font_draw(font, str, color, screen, x, y, ox, max_w);
+	Profiler_end(kProfileText);
+}
+
+///////////////////////////////////////
+
+// drawing and presenting run on their own thread so a slow SDL_Flip() or resume probe
+// never holds up input, the input thread publishes an immutable View of everything
+// on screen and the render thread draws whichever one is the latest
+
+#define kMaxTextWidth 288 // 320-32
+
+typedef struct ViewRow {
+	char name[256];
+	char fullname[256]; // drawn behind or instead of name when it conflicts
+	int conflict;
+} ViewRow;
+typedef struct View {
+	int generation; // changes with everything but scroll_ox
+	int count; // entries in the directory
+	int selected;
+	int start;
+	int end;
+	int depth; // open directories
+	char selected_path[256]; // for the resume probe
+	int selected_type;
+	int show_setting; // 1=brightness,2=volume
+	int setting_value;
+	int setting_max;
+	int scroll_ox;
+	LatencyTrace latency;
+	uint32_t profile[kProfilePhaseCount]; // the input thread's share of the frame
+	ViewRow rows[kMaxRows];
+} View;
+
+static void View_capture(View* self, int generation, int show_setting, int setting_value, int setting_max, int scroll_ox) {
+	self->generation = generation;
+	self->count = top->entries->count;
+	self->selected = top->selected;
+	self->start = top->start;
+	self->end = top->end;
+	self->depth = stack->count;
+	self->selected_path[0] = '\0';
+	self->selected_type = 0;
+	if (self->count) {
+		Entry* entry = top->entries->items[top->selected];
+		Entry_getPath(entry, self->selected_path);
+		self->selected_type = entry->type;
+	}
+	self->show_setting = show_setting;
+	self->setting_value = setting_value;
+	self->setting_max = setting_max;
+	self->scroll_ox = scroll_ox;
+	
+	for (int i=top->start; i<top->end; i++) {
+		Entry* entry = top->entries->items[i];
+		ViewRow* row = &self->rows[i-top->start];
+		Entry_getName(entry, row->name);
+		snprintf(row->fullname, sizeof(row->fullname), "%s", Entry_getFileName(entry));
+		row->conflict = entry->conflict;
+	}
+}
+
+static SDL_Thread* render_thread;
+static SDL_mutex* render_mutex;
+static SDL_cond* render_wake; // a view was published
+static SDL_cond* render_idle; // the latest view was presented
+static View render_view; // latest published, guarded by render_mutex
+static int render_pending = 0; // render_view hasn't been picked up yet
+static int render_busy = 0; // a picked up view is being drawn
+static int render_quit = 0;
+static int render_needs_scrolling = 0; // the selected name is wider than its row
+static int render_can_resume = 0; // result of the last probe...
+static char render_resume_path[256]; // ...of this entry...
+static char render_slot_path[256]; // ...which found this slot
+
+static Font* font;
+static Font* tiny;
+
+static Sprite* ui_logo;
+static Sprite* ui_highlight_bar;
+static Sprite* ui_top_bar;
+static Sprite* ui_bottom_bar;
+static Sprite* ui_browse_icon;
+static Sprite* ui_round_button;
+static Sprite* ui_menu_icon;
+static Sprite* ui_start_icon;
+
+static Sprite* ui_power_0_icon;
+static Sprite* ui_power_20_icon;
+static Sprite* ui_power_50_icon;
+static Sprite* ui_power_80_icon;
+static Sprite* ui_power_100_icon;
+
+static Sprite* ui_settings_bar_empty;
+static Sprite* ui_settings_bar_full;
+static Sprite* ui_brightness_icon;
+static Sprite* ui_volume_icon;
+static Sprite* ui_mute_icon;
+
+static int Render_probe(View* view) { // returns can_resume for the view's selection
+	// a rom's save state can't change while MinUI is on screen so only probe each selection once,
+	// Resident_reclaim() forgets the probe because the game that just ran may have changed it
+	if (!exact_match(render_resume_path, view->selected_path)) {
+		char slot[256];
+		Profiler_begin(kProfileResume);
+		int can_resume = ready_resume(view->selected_path, view->selected_type, slot);
+		Profiler_end(kProfileResume);
+		
+		SDL_LockMutex(render_mutex);
+		render_can_resume = can_resume;
+		strcpy(render_resume_path, view->selected_path);
+		strcpy(render_slot_path, slot);
+		SDL_UnlockMutex(render_mutex);
+	}
+	return render_can_resume;
+}
+
+static int Render_draw(View* view) { // returns 1 if the selected name needs scrolling
+	Profiler_begin(kProfileBlit);
+	int needs_scrolling = 0;
+	int can_resume = Render_probe(view);
+	SDL_Color color = {0xff,0xff,0xff};
+	
+	// clear
+	Blit_fill(screen, NULL, 0);
+	
+	// chrome
+	Sprite_blit(ui_top_bar, NULL, screen, 0,0);
+	Sprite_blit(ui_bottom_bar, NULL, screen, 0,202);
+	
+	// logo
+	Sprite_blit(ui_logo, NULL, screen, 10,10);
+	
+	if (view->show_setting) {
+		// icon
+		Sprite_blit(view->show_setting==1?ui_brightness_icon:(view->setting_value>0?ui_volume_icon:ui_mute_icon), NULL, screen, 178,9);
+		// bar
+		Sprite_blit(ui_settings_bar_empty, NULL, screen, 202,16);
+		int w = 108 * ((float)view->setting_value / view->setting_max);
+		Sprite_blit(ui_settings_bar_full, &(SDL_Rect){0,0,w,4}, screen, 202,16);
+	}
+	else {
+		// x/y text
+		if (view->count) {
+			char mini[8];
+			sprintf(mini, "/%d", view->count);
+			drawText(tiny, mini, (SDL_Color){0xd2,0xb4,0x6c}, 184,9, 0,0);
+	
+			sprintf(mini, "%d", view->selected+1);
+			drawText(tiny, mini, (SDL_Color){0xd2,0xb4,0x6c}, 184-Font_width(tiny, mini),9, 0,0);
+		}
+		
+		// battery
+		int charge = getBatteryLevel();
+		Sprite* ui_power_icon;
+		if (charge<41)		ui_power_icon = ui_power_0_icon;
+		else if (charge<43) ui_power_icon = ui_power_20_icon;
+		else if (charge<44) ui_power_icon = ui_power_50_icon;
+		else if (charge<46) ui_power_icon = ui_power_80_icon;
+		else				ui_power_icon = ui_power_100_icon;
+		Sprite_blit(ui_power_icon, NULL, screen, 294,6);
+	}
+	
+	if (view->count) {
+		if (can_resume) {
+			// X Resume
+			Sprite_blit(ui_round_button, NULL, screen, 10,210);
+			drawText(tiny, "RESUME", (SDL_Color){0xff,0xff,0xff}, 35,212, 0,0);
+	
+			drawText(font, "X", (SDL_Color){0x9f,0x89,0x52}, 10+6,210+1, 0,0);
+		}
+		else {
+			Sprite_blit(ui_menu_icon, NULL, screen, 10,210);
+			drawText(tiny, "SLEEP", (SDL_Color){0xff,0xff,0xff}, 56,212, 0,0);
+		}
+	
+		// A Open
+		Sprite_blit(ui_round_button, NULL, screen, 251,210);
+		drawText(tiny, "OPEN", (SDL_Color){0xff,0xff,0xff}, 276,212, 0,0);
+	
+		drawText(font, "A", (SDL_Color){0x9f,0x89,0x52}, 251+6,210+1, 0,0);
+	
+		// B Back
+		if (view->depth>1) {
+			Sprite_blit(ui_round_button, NULL, screen, 251-68,210);
+			drawText(tiny, "BACK", (SDL_Color){0xff,0xff,0xff}, 276-68,212, 0,0);
+	
+			drawText(font, "B", (SDL_Color){0x9f,0x89,0x52}, 251+6-68+1,210+1, 0,0);
+		}
+	}
+	
+	int y = 0;
+	for (int i=view->start; i<view->end; i++) {
+		ViewRow* row = &view->rows[i-view->start];
+
+		if (view->selected==i) {
+			char* name = row->conflict ? row->fullname : row->name;
+			
+			// bar
+			Sprite_blit(ui_highlight_bar, NULL, screen, 0,38+y);
+			
+			// shadow
+			if (Font_width(font, name)>kMaxTextWidth) needs_scrolling = 1;
+			drawText(font, name, (SDL_Color){0x68,0x5a,0x35}, 16+1,38+y+6+2, 0,kMaxTextWidth);
+			
+			drawText(font, name, color, 16,38+y+6, 0,kMaxTextWidth);
+		}
+		else {
+			if (row->conflict) {
+				drawText(font, row->fullname, (SDL_Color){0x66,0x66,0x66}, 16,38+y+6, 0,kMaxTextWidth);
+			}
+			
+			drawText(font, row->name, color, 16,38+y+6, 0,kMaxTextWidth);
+		}
+		
+		y += 32;
+	}
+	
+	Profiler_end(kProfileBlit);
+	Profiler_drawOverlay(screen, tiny);
+	return needs_scrolling;
+}
+static int Render_drawScroll(View* view) { // returns 1 if it drew, 0 once the end of the name is visible
+	Profiler_begin(kProfileBlit);
+	int i = view->selected;
+	int y = 32 * (i - view->start);
+	
+	ViewRow* row = &view->rows[i-view->start];
+	char* name = row->conflict ? row->fullname : row->name;
+	
+	int drew = 0;
+	if (Font_width(font, name)-view->scroll_ox>kMaxTextWidth) {
+		// bar
+		Sprite_blit(ui_highlight_bar, NULL, screen, 0,38+y);
+	
+		// shadow
+		drawText(font, name, (SDL_Color){0x68,0x5a,0x35}, 16+1,38+y+6+2, view->scroll_ox,kMaxTextWidth);
+		drawText(font, name, (SDL_Color){0xff,0xff,0xff}, 16,38+y+6, view->scroll_ox,kMaxTextWidth);
+		drew = 1;
+	}
+	Profiler_end(kProfileBlit);
+	return drew;
+}
+
+static int Render_thread(void* unused) {
+	View view;
+	int drawn = -1; // generation on screen
+	int needs_scrolling = 0;
+	int did_flip = 0;
+	
+	SDL_LockMutex(render_mutex);
+	while (1) {
+		while (!render_pending && !render_quit) SDL_CondWait(render_wake, render_mutex);
+		if (render_quit) break;
+		
+		memcpy(&view, &render_view, sizeof(View));
+		render_pending = 0;
+		render_busy = 1;
+		SDL_UnlockMutex(render_mutex);
+		
+		int64_t start = Timeline_now();
+		int drew = 0;
+		if (view.generation!=drawn) {
+			needs_scrolling = Render_draw(&view);
+			drawn = view.generation;
+			drew = 1;
+		}
+		else if (needs_scrolling) {
+			needs_scrolling = Render_drawScroll(&view);
+			drew = needs_scrolling;
+		}
+		
+		if (drew) {
+			Latency_mark(&view.latency, kLatencyRender);
+			Profiler_begin(kProfileFlip);
+			SDL_Flip(screen); // TODO: just update the modified rect when scrolling?
+			Profiler_end(kProfileFlip);
+			Latency_flip(&view.latency);
+			if (!did_flip) Timeline_mark("first_flip", NULL);
+			did_flip = 1;
+			Profiler_endRender(view.profile, start);
+		}
+		
+		SDL_LockMutex(render_mutex);
+		render_needs_scrolling = needs_scrolling;
+		render_busy = 0;
+		if (!render_pending) SDL_CondSignal(render_idle);
+	}
+	SDL_UnlockMutex(render_mutex);
+	return 0;
+}
+
+static void Render_init(void) {
+	font = Font_open(kResDir "BPreplayBold.otf", kResDir "BPreplayBold-16.atlas", 16);
+	tiny = Font_open(kResDir "BPreplayBold.otf", kResDir "BPreplayBold-14.atlas", 14);
+	
+	ui_logo					= Sprite_load(kResDir "logo.png");
+	ui_highlight_bar		= Sprite_load(kResDir "list-selected-bg.png");
+	ui_top_bar				= Sprite_load(kResDir "title-bg.png");
+	ui_bottom_bar			= Sprite_load(kResDir "tips-bar-bg.png");
+	ui_browse_icon			= Sprite_load(kResDir "stat-nav-icon.png");
+	ui_round_button			= Sprite_load(kResDir "nav-bar-item-bg.png");
+	ui_menu_icon			= Sprite_load(kResDir "stat-menu-icon.png");
+	ui_start_icon			= Sprite_load(kResDir "stat-start-icon.png");
+	
+	ui_power_0_icon			= Sprite_load(kResDir "power-0%-icon.png");
+	ui_power_20_icon		= Sprite_load(kResDir "power-20%-icon.png");
+	ui_power_50_icon		= Sprite_load(kResDir "power-50%-icon.png");
+	ui_power_80_icon		= Sprite_load(kResDir "power-80%-icon.png");
+	ui_power_100_icon		= Sprite_load(kResDir "power-full-icon.png");
+
+	ui_settings_bar_empty	= Sprite_load(kResDir "settings-bar-empty.png");
+	ui_settings_bar_full	= Sprite_load(kResDir "settings-bar-full.png");
+	ui_brightness_icon		= Sprite_load(kResDir "settings-icon-brightness.png");
+	ui_volume_icon			= Sprite_load(kResDir "settings-icon-volume.png");
+	ui_mute_icon			= Sprite_load(kResDir "settings-icon-volume-mute.png");
+	
+	render_resume_path[0] = '\0';
+	render_mutex = SDL_CreateMutex();
+	render_wake = SDL_CreateCond();
+	render_idle = SDL_CreateCond();
+	render_thread = SDL_CreateThread(Render_thread, NULL);
+}
+static void Render_publish(View* view) { // input thread
+	Latency_handoff(&view->latency);
+	Profiler_handoff(view->profile);
+	
+	SDL_LockMutex(render_mutex);
+	// a view that was never picked up may still carry the oldest unpresented input
+	LatencyTrace latency = render_view.latency;
+	int carry = render_pending && latency.origin;
+	memcpy(&render_view, view, sizeof(View));
+	if (carry) render_view.latency = latency;
+	render_pending = 1;
+	SDL_CondSignal(render_wake);
+	SDL_UnlockMutex(render_mutex);
+}
+static void Render_sync(void) { // input thread, waits until the latest view is on screen, the screen is then ours until the next publish
+	SDL_LockMutex(render_mutex);
+	while (render_pending || render_busy) SDL_CondWait(render_idle, render_mutex);
+	SDL_UnlockMutex(render_mutex);
+}
+static int Render_needsScrolling(void) {
+	SDL_LockMutex(render_mutex);
+	int needs_scrolling = render_needs_scrolling;
+	SDL_UnlockMutex(render_mutex);
+	return needs_scrolling;
+}
+static int Render_isBusy(void) { // a view is still waiting to be drawn or being drawn
+	SDL_LockMutex(render_mutex);
+	int busy = render_pending || render_busy;
+	SDL_UnlockMutex(render_mutex);
+	return busy;
+}
+static int Render_canResume(Entry* entry) { // copies the probed slot into slot_path when it can
+	SDL_LockMutex(render_mutex);
+	char path[256];
+	int can_resume = render_can_resume && exact_match(render_resume_path, Entry_getPath(entry, path));
+	if (can_resume) strcpy(slot_path, render_slot_path);
+	SDL_UnlockMutex(render_mutex);
+	return can_resume;
+}
+static void Render_quit(void) {
+	SDL_LockMutex(render_mutex);
+	render_quit = 1;
+	SDL_CondSignal(render_wake);
+	SDL_UnlockMutex(render_mutex);
+	SDL_WaitThread(render_thread, NULL);
+	
+	SDL_DestroyCond(render_wake);
+	SDL_DestroyCond(render_idle);
+	SDL_DestroyMutex(render_mutex);
+	
+	Sprite_free(ui_logo);
+	Sprite_free(ui_highlight_bar);
+	Sprite_free(ui_top_bar);
+	Sprite_free(ui_bottom_bar);
+	Sprite_free(ui_browse_icon);
+	Sprite_free(ui_round_button);
+	Sprite_free(ui_menu_icon);
+	Sprite_free(ui_start_icon);
+	Sprite_free(ui_power_0_icon);
+	Sprite_free(ui_power_20_icon);
+	Sprite_free(ui_power_50_icon);
+	Sprite_free(ui_power_80_icon);
+	Sprite_free(ui_power_100_icon);
+	
+	Sprite_free(ui_settings_bar_empty);
+	Sprite_free(ui_settings_bar_full);
+	Sprite_free(ui_brightness_icon);
+	Sprite_free(ui_volume_icon);
+	Sprite_free(ui_mute_icon);
+	
+	Font_close(font);
+	Font_close(tiny);
+}
+
+///////////////////////////////////////
+
+#define kResidentLogPath kRootDir "/.minui/logs/resident.txt"
+#define TRIMUI_SHOW unused1 // the stock SDL's show flag, both for compatibility pre and post 1.7
+
+static long getResidentKB(void) {
+	long size = 0;
+	long resident = 0;
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (file) {
+		if (fscanf(file, "%li %li", &size, &resident)!=2) resident = 0;
+		fclose(file);
+	}
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void Resident_release(void) {
+	Render_sync();
+	Blit_fill(screen, NULL, 0);
+	SDL_Flip(screen);
+	
+	// let go of the framebuffer and keyboard like exiting would, sprites are plain memory and survive
+	putenv("trimui_show=no");
+	screen->TRIMUI_SHOW = 0;
+	SDL_QuitSubSystem(SDL_INIT_VIDEO);
+	
+	Font_trim(font);
+	Font_trim(tiny);
+	malloc_trim(0);
+}
+static void Resident_reclaim(void) {
+	SDL_InitSubSystem(SDL_INIT_VIDEO);
+	screen = SDL_SetVideoMode(320, 240, 16, SDL_SWSURFACE);
+	screen->TRIMUI_SHOW = 1;
+	putenv("trimui_show=yes");
+	SDL_ShowCursor(0);
+	SDL_EnableKeyRepeat(0,0); // see Input_repeat()
+	
+	reapplySettings();
+	setCPU(kCPUNormal);
+	if (exists(kResumeSlotPath)) unlink(kResumeSlotPath);
+	
+	// the game may have saved or deleted the selected rom's state, probe it again
+	SDL_LockMutex(render_mutex);
+	render_resume_path[0] = '\0';
+	render_can_resume = 0;
+	SDL_UnlockMutex(render_mutex);
+	
+	// a cold start would rebuild these: a first recent adds Recently Played to the root,
+	// its order just changed and the in-game menu may have picked another disc
+	Directory* root = stack->items[0];
+	if (exists(kChangeDiscPath) || exact_match(top->path, kRecentlyPlayedDir) || Directory_indexOf(root, kRecentlyPlayedDir)<0) {
+		// start over like a cold start would, top and the restore_* values describe the menu being freed,
+		// the render thread's View holds copies of names and paths so nothing it draws points into it
+		Menu_quit();
+		top = NULL;
+		restore_relative = -1;
+		restore_selected = 0;
+		restore_start = 0;
+		restore_end = 0;
+		Menu_init();
+	}
+}
+
+static void Resident_run(void) {
+	resident_pending = 0;
+	Prewarm_select(""); // the game needs the card more than the menu does
+	Resident_release();
+	Memory_report("resident"); // what MinUI holds on to while the game runs
+	long menu_kb = getResidentKB();
+	
+	setPowerState(POWER_GAME);
+	Timeline_mark("eval", resident_name);
+	struct rusage usage;
+	memset(&usage, 0, sizeof(usage));
+	pid_t pid = fork();
+	if (pid==0) {
+		execl("/bin/sh", "sh", "-c", resident_cmd, (char*)NULL);
+		_exit(127);
+	}
+	if (pid>0) {
+		while (wait4(pid, NULL, 0, &usage)<0 && errno==EINTR);
+	}
+	else printf("could not fork %s\n", resident_cmd);
+	Timeline_mark("eval_done", resident_name);
+	
+	// what System.pak does after eval'ing next.sh
+	if (exists("/tmp/using-swap")) {
+		unlink("/tmp/using-swap");
+		system("swapoff -a");
+	}
+	system("logring flush");
+	sync();
+	Timeline_mark("game_sync", resident_name);
+	
+	unsigned long start = SDL_GetTicks();
+	Resident_reclaim();
+	setPowerState(POWER_BROWSING);
+	
+	FILE* file = fopen(kResidentLogPath, "a");
+	if (file) {
+		// ru_maxrss covers the shell and whatever it waited on, ie. the emulator
+		fprintf(file, "%s: menu %liKB while resident, game peak %liKB, menu back in %lums\n",
+			resident_name, menu_kb, usage.ru_maxrss, SDL_GetTicks() - start);
+		fclose(file);
+	}
 }
 
 int main(void) {	
+	Timeline_mark("main", NULL);
 	// freopen(kRootDir "/stderr.txt", "w", stderr);
 	// freopen(kRootDir "/stdout.txt", "w", stdout);
 	signal(SIGSEGV, error_handler); // runtime error reporting
+	signal(SIGUSR1, memory_handler); // on demand memory report
+	setvbuf(stdout, NULL, _IOLBF, 0); // stdout is logring's pipe to RAM, lines are cheap and survive a crash
+	Sampler_init(); // opt-in, see sampler.h
 	
 	// if (exists("/dev/dsp1")) putenv("AUDIODEV=/dev/dsp1"); // headphones
 	// else putenv("AUDIODEV=/dev/dsp"); // speaker
@@ -1154,22 +1580,21 @@ int main(void) {
 	// }
 	
 	restoreSettings();
+	setCPU(kCPUNormal); // undo the launch profile of whatever ran last, see applyCPUProfile()
 	// applyTearingPatch();
 	
+	keyshm = KeyShm_open();
+	
 	screen = SDL_SetVideoMode(320, 240, 16, SDL_SWSURFACE);
 
 	// both for compatibility pre and post 1.7
-	#define TRIMUI_SHOW unused1
 	screen->TRIMUI_SHOW = 1;
 	putenv("trimui_show=yes");
 	
 	SDL_ShowCursor(0);
-	SDL_EnableKeyRepeat(300,100);
+	SDL_EnableKeyRepeat(0,0); // see Input_repeat()
 	
 	TTF_Init();
-	TTF_Font* font = TTF_OpenFont(kResDir "BPreplayBold.otf", 16);
-	TTF_Font* tiny = TTF_OpenFont(kResDir "BPreplayBold.otf", 14);
-	SDL_Color color = {0xff,0xff,0xff};
 	
 	// one-time instruction for wake from sleep
 	if (access("/mnt/SDCARD/.minui/can-sleep", 4)!=0) {
@@ -1183,34 +1608,22 @@ int main(void) {
 		close(open("/mnt/SDCARD/.minui/can-sleep", O_RDWR|O_CREAT, 0777)); // basically touch
 	}
 	
-	SDL_Surface* ui_logo				= IMG_Load(kResDir "logo.png");
-	SDL_Surface* ui_highlight_bar		= IMG_Load(kResDir "list-selected-bg.png");
-	SDL_Surface* ui_top_bar				= IMG_Load(kResDir "title-bg.png");
-	SDL_Surface* ui_bottom_bar			= IMG_Load(kResDir "tips-bar-bg.png");
-	SDL_Surface* ui_browse_icon			= IMG_Load(kResDir "stat-nav-icon.png");
-	SDL_Surface* ui_round_button		= IMG_Load(kResDir "nav-bar-item-bg.png");
-	SDL_Surface* ui_menu_icon			= IMG_Load(kResDir "stat-menu-icon.png");
-	SDL_Surface* ui_start_icon			= IMG_Load(kResDir "stat-start-icon.png");
-	
-	SDL_Surface* ui_power_0_icon		= IMG_Load(kResDir "power-0%-icon.png");
-	SDL_Surface* ui_power_20_icon		= IMG_Load(kResDir "power-20%-icon.png");
-	SDL_Surface* ui_power_50_icon		= IMG_Load(kResDir "power-50%-icon.png");
-	SDL_Surface* ui_power_80_icon		= IMG_Load(kResDir "power-80%-icon.png");
-	SDL_Surface* ui_power_100_icon		= IMG_Load(kResDir "power-full-icon.png");
-
-	SDL_Surface* ui_settings_bar_empty	= IMG_Load(kResDir "settings-bar-empty.png");
-	SDL_Surface* ui_settings_bar_full	= IMG_Load(kResDir "settings-bar-full.png");
-	SDL_Surface* ui_brightness_icon		= IMG_Load(kResDir "settings-icon-brightness.png");
-	SDL_Surface* ui_volume_icon			= IMG_Load(kResDir "settings-icon-volume.png");
-	SDL_Surface* ui_mute_icon			= IMG_Load(kResDir "settings-icon-volume-mute.png");
-
+	Render_init();
+	
 	// Mix_Chunk *click = Mix_LoadWAV("/usr/trimui/res/sound/click.wav");
 	
+	State_open();
 	load_screenshots();
+	Latency_init();
+	Profiler_init();
 	
 	if (exists(kResumeSlotPath)) unlink(kResumeSlotPath);
+	enable_resident = exists(kRootDir "/.minui/enable-resident");
+	PowerStats_init(&power, "MinUI", POWER_BROWSING);
+	PowerStats_publish(&power, POWER_BROWSING);
 	
 	Menu_init();
+	Prewarm_init();
 	
 	if (!has_roms) {
 		SDL_Surface* ui_roms = IMG_Load("/mnt/SDCARD/System/res/roms.png");
@@ -1232,16 +1645,18 @@ int main(void) {
 		SDL_FreeSurface(ui_roms);
 	}
 	
-	SDL_FillRect(screen, NULL, 0);
+	Blit_fill(screen, NULL, 0);
 	
 	SDL_Event event;
+	View view; // the last one published
+	int generation = 0;
 	int is_dirty = 1;
 	int show_setting = 0; // 1=brightness,2=volume
 	int setting_value = 0;
 	int setting_max = 0;
-	int needs_scrolling = 0;
 	int is_scrolling = 0;
 	int scroll_ox = 0;
+	int was_repeating = 0;
 	int disable_sleep = exists("/tmp/disable-sleep");
 	unsigned long cancel_start = SDL_GetTicks();
 	unsigned long wait_start = SDL_GetTicks();
@@ -1249,6 +1664,9 @@ int main(void) {
 		unsigned long frame_start = SDL_GetTicks();
 		int cancel_sleep = 0;
 		int cancel_wait = 0;
+		int did_publish = 0;
+		Profiler_begin(kProfileFrame);
+		Profiler_begin(kProfileInput);
 		Input_beforePoll();
 		while (SDL_PollEvent(&event)) {
 			int btn;
@@ -1258,12 +1676,11 @@ int main(void) {
 					cancel_wait = 1;
 					btn = Input_getButton(&event);
 					if (btn==kButtonNull) continue;
+					
+					if (buttons[btn].isPressed) continue;
+					Latency_event(btn, 0);
 
-					buttons[btn].justRepeated = 1;
-					if (!buttons[btn].isPressed) {
-						buttons[btn].justPressed = 1;
-						buttons[btn].isPressed = 1;
-					}
+					Input_press(btn, SDL_GetTicks());
 					// Mix_PlayChannel(-1, click, 0);
 				break;
 				
@@ -1278,62 +1695,84 @@ int main(void) {
 				break;
 			}
 		}
+		int repeated = Input_repeat(SDL_GetTicks());
+		if (repeated!=kButtonNull) {
+			cancel_sleep = 1;
+			cancel_wait = 1;
+			Latency_event(repeated, 1);
+		}
+		Profiler_end(kProfileInput);
 		
-		
-		if (enable_screenshots && Input_justPressed(kButtonY)) save_screenshot(NULL);
+		Profiler_begin(kProfileNav);
+		if (enable_screenshots && Input_justPressed(kButtonY)) {
+			Render_sync();
+			save_screenshot(NULL);
+		}
 		
 		int selected = top->selected;
 		int total = top->entries->count;
+		// a held direction's repeats are summed into one stride per frame, a stride stops
+		// at either end of the list and only the next repeat from there wraps around
 		if (Input_justRepeated(kButtonUp)) {
-			selected -= 1;
-			if (selected<0) {
-				selected = total-1;
-				int start = total - kMaxRows;
-				top->start = (start<0) ? 0 : start;
-				top->end = total;
-			}
-			else if (selected<top->start) {
-				top->start -= 1;
-				top->end -= 1;
+			for (int i=0; i<Input_justRepeated(kButtonUp); i++) {
+				if (i>0 && selected==0) break;
+				selected -= 1;
+				if (selected<0) {
+					selected = total-1;
+					int start = total - kMaxRows;
+					top->start = (start<0) ? 0 : start;
+					top->end = total;
+				}
+				else if (selected<top->start) {
+					top->start -= 1;
+					top->end -= 1;
+				}
 			}
 		}
 		else if (Input_justRepeated(kButtonDown)) {
-			selected += 1;
-			if (selected>=total) {
-				selected = 0;
-				top->start = 0;
-				top->end = (total<kMaxRows) ? total : kMaxRows;
-			}
-			else if (selected>=top->end) {
-				top->start += 1;
-				top->end += 1;
+			for (int i=0; i<Input_justRepeated(kButtonDown); i++) {
+				if (i>0 && selected==total-1) break;
+				selected += 1;
+				if (selected>=total) {
+					selected = 0;
+					top->start = 0;
+					top->end = (total<kMaxRows) ? total : kMaxRows;
+				}
+				else if (selected>=top->end) {
+					top->start += 1;
+					top->end += 1;
+				}
 			}
 		}
 		if (Input_justRepeated(kButtonLeft)) {
-			selected -= kMaxRows;
-			if (selected<0) {
-				selected = 0;
-				top->start = 0;
-				top->end = (total<kMaxRows) ? total : kMaxRows;
-			}
-			else if (selected<top->start) {
-				top->start -= kMaxRows;
-				if (top->start<0) top->start = 0;
-				top->end = top->start + kMaxRows;
+			for (int i=0; i<Input_justRepeated(kButtonLeft) && selected>0; i++) {
+				selected -= kMaxRows;
+				if (selected<0) {
+					selected = 0;
+					top->start = 0;
+					top->end = (total<kMaxRows) ? total : kMaxRows;
+				}
+				else if (selected<top->start) {
+					top->start -= kMaxRows;
+					if (top->start<0) top->start = 0;
+					top->end = top->start + kMaxRows;
+				}
 			}
 		}
 		else if (Input_justRepeated(kButtonRight)) {
-			selected += kMaxRows;
-			if (selected>=total) {
-				selected = total-1;
-				int start = total - kMaxRows;
-				top->start = (start<0) ? 0 : start;
-				top->end = total;
-			}
-			else if (selected>=top->end) {
-				top->end += kMaxRows;
-				if (top->end>total) top->end = total;
-				top->start = top->end - kMaxRows;
+			for (int i=0; i<Input_justRepeated(kButtonRight) && selected<total-1; i++) {
+				selected += kMaxRows;
+				if (selected>=total) {
+					selected = total-1;
+					int start = total - kMaxRows;
+					top->start = (start<0) ? 0 : start;
+					top->end = total;
+				}
+				else if (selected>=top->end) {
+					top->end += kMaxRows;
+					if (top->end>total) top->end = total;
+					top->start = top->end - kMaxRows;
+				}
 			}
 		}
 		if (!Input_isPressed(kButtonStart) && !Input_isPressed(kButtonSelect)) {
@@ -1370,29 +1809,32 @@ int main(void) {
 			is_dirty = 1;
 		}
 		
-		if (is_dirty) {
-			ready_resume(top->entries->items[top->selected]);
-			
-			// Entry* entry = top->entries->items[top->selected];
-			// if (entry->type==kEntryRom) ready_resume(entry->path);
-			// else can_resume = 0;
-		}
 		
-		if (can_resume && Input_justPressed(kButtonX)) {
+		// the render thread probes each selection it draws, X only resumes what it showed as resumable
+		if (Input_justPressed(kButtonX) && Render_canResume(top->entries->items[top->selected])) {
 			should_resume = 1;
+			markPress(kButtonX);
 			Entry_open(top->entries->items[top->selected]);
 			is_dirty = 1;
 		}
 		else if (Input_justPressed(kButtonA)) {
+			markPress(kButtonA);
 			Entry_open(top->entries->items[top->selected]);
 			is_dirty = 1;
-			
-			ready_resume(top->entries->items[top->selected]);
 		}
 		else if (Input_justPressed(kButtonB) && stack->count>1) {
 			close_directory();
 			is_dirty = 1;
-			can_resume = 0;
+		}
+		Profiler_end(kProfileNav);
+		
+		if (resident_pending) {
+			Resident_run();
+			Input_reset();
+			Latency_cancel(&latency_pending);
+			Profiler_begin(kProfileFrame); // don't count time in the game
+			cancel_start = wait_start = SDL_GetTicks();
+			is_dirty = 1;
 		}
 		
 		unsigned long now = SDL_GetTicks();
@@ -1410,15 +1852,21 @@ int main(void) {
 		#define kSleepDelay 30000
 		if (cancel_sleep || disable_sleep) cancel_start = now;
 		if (Input_justPressed(kButtonMenu) || now-cancel_start>=kSleepDelay) {
-			SDL_FillRect(screen, NULL, 0);
+			Render_sync();
+			Blit_fill(screen, NULL, 0);
 			SDL_Flip(screen);
 			
 			fauxSleep();
 			Input_reset();
+			Latency_cancel(&latency_pending);
+			Profiler_begin(kProfileFrame); // don't count time asleep
 			cancel_start = SDL_GetTicks();
 			is_dirty = 1;
 		}
 		
+		#define kIdleDelay 5000 // without input, for the power stats
+		setPowerState(SDL_GetTicks()-wait_start>=kIdleDelay ? POWER_IDLE : POWER_BROWSING);
+		
 		int old_setting = show_setting;
 		int old_value = setting_value;
 		show_setting = 0;
@@ -1427,219 +1875,76 @@ int main(void) {
 		}
 		else if (Input_isPressed(kButtonStart)) {
 			show_setting = 1;
-			setting_value = GetBrightness();
+			setting_value = getSetting(show_setting);
 			setting_max = 10;
 			// printf("show brightness: %i\n", setting_value, setting_max);
 		}
 		else if (Input_isPressed(kButtonSelect)) {
 			show_setting = 2;
-			setting_value = GetVolume();
+			setting_value = getSetting(show_setting);
 			setting_max = 20;
 			// printf("show volume: %i\n", setting_value, setting_max);
 		}
 		if (old_setting!=show_setting || old_value!=setting_value) is_dirty = 1;
 		
-		#define kMaxTextWidth 288 // 320-32
-		if (is_dirty) {
-			needs_scrolling = 0;
-			
-			// clear
-			SDL_FillRect(screen, NULL, 0);
-			
-			// chrome
-			SDL_BlitSurface(ui_top_bar, NULL, screen, NULL);
-			SDL_BlitSurface(ui_bottom_bar, NULL, screen, &(SDL_Rect){0,202,0,0});
-			
-			SDL_Surface* text;
-			
-			// logo
-			SDL_BlitSurface(ui_logo, NULL, screen, &(SDL_Rect){10,10,0,0});
-			
-			if (show_setting) {
-				// icon
-				SDL_BlitSurface(show_setting==1?ui_brightness_icon:(setting_value>0?ui_volume_icon:ui_mute_icon), NULL, screen, &(SDL_Rect){178,9,0,0});
-				// bar
-				SDL_BlitSurface(ui_settings_bar_empty, NULL, screen, &(SDL_Rect){202,16,0,0});
-				int w = 108 * ((float)setting_value / setting_max);
-				SDL_BlitSurface(ui_settings_bar_full, &(SDL_Rect){0,0,w,4}, screen, &(SDL_Rect){202,16,w,4});
-			}
-			else {
-				// x/y text
-				if (top->entries->count && !show_setting) {
-					char mini[8];
-					sprintf(mini, "/%d", top->entries->count);
-					text = TTF_RenderUTF8_Blended(tiny, mini, (SDL_Color){0xd2,0xb4,0x6c});
-					SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){184,9,0,0});
-					SDL_FreeSurface(text);
-			
-					sprintf(mini, "%d", top->selected+1);
-					text = TTF_RenderUTF8_Blended(tiny, mini, (SDL_Color){0xd2,0xb4,0x6c});
-					SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){184-text->w,9,0,0});
-					SDL_FreeSurface(text);
-				}
-				
-				// battery
-				int charge = getBatteryLevel();
-				SDL_Surface* ui_power_icon;
-				if (charge<41)		ui_power_icon = ui_power_0_icon;
-				else if (charge<43) ui_power_icon = ui_power_20_icon;
-				else if (charge<44) ui_power_icon = ui_power_50_icon;
-				else if (charge<46) ui_power_icon = ui_power_80_icon;
-				else				ui_power_icon = ui_power_100_icon;
-				SDL_BlitSurface(ui_power_icon, NULL, screen, &(SDL_Rect){294,6,0,0});
-			}
-			
-			if (top->entries->count) {
-				if (can_resume) {
-					// X Resume
-					SDL_BlitSurface(ui_round_button, NULL, screen, &(SDL_Rect){10,210,0,0});
-					text = TTF_RenderUTF8_Blended(tiny, "RESUME", (SDL_Color){0xff,0xff,0xff});
-					SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){35,212,0,0});
-					SDL_FreeSurface(text);
-			
-					text = TTF_RenderUTF8_Blended(font, "X", (SDL_Color){0x9f,0x89,0x52});
-					SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){10+6,210+1,0,0});
-					SDL_FreeSurface(text);
-				}
-				else {
-					SDL_BlitSurface(ui_menu_icon, NULL, screen, &(SDL_Rect){10,210,0,0});
-					text = TTF_RenderUTF8_Blended(tiny, "SLEEP", (SDL_Color){0xff,0xff,0xff});
-					SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){56,212,0,0});
-					SDL_FreeSurface(text);
-				}
-			
-				// A Open
-				SDL_BlitSurface(ui_round_button, NULL, screen, &(SDL_Rect){251,210,0,0});
-				text = TTF_RenderUTF8_Blended(tiny, "OPEN", (SDL_Color){0xff,0xff,0xff});
-				SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){276,212,0,0});
-				SDL_FreeSurface(text);
-			
-				text = TTF_RenderUTF8_Blended(font, "A", (SDL_Color){0x9f,0x89,0x52});
-				SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){251+6,210+1,0,0});
-				SDL_FreeSurface(text);
-			
-				// B Back
-				if (stack->count>1) {
-					SDL_BlitSurface(ui_round_button, NULL, screen, &(SDL_Rect){251-68,210,0,0});
-					text = TTF_RenderUTF8_Blended(tiny, "BACK", (SDL_Color){0xff,0xff,0xff});
-					SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){276-68,212,0,0});
-					SDL_FreeSurface(text);
-			
-					text = TTF_RenderUTF8_Blended(font, "B", (SDL_Color){0x9f,0x89,0x52});
-					SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){251+6-68+1,210+1,0,0});
-					SDL_FreeSurface(text);
-				}
-			}
-			
-			int y = 0;
-			for (int i=top->start; i<top->end; i++) {
-				Entry* entry = top->entries->items[i];
-				char* fullname = strrchr(entry->path, '/')+1;
-
-				if (top->selected==i) {
-					char* name = entry->conflict ? fullname : entry->name;
-					
-					// bar
-					SDL_BlitSurface(ui_highlight_bar, NULL, screen, &(SDL_Rect){0,38+y,0,0});
-					
-					// shadow
-					text = TTF_RenderUTF8_Blended(font, name, (SDL_Color){0x68,0x5a,0x35});
-					if (text->w>kMaxTextWidth) needs_scrolling = 1;
-					SDL_BlitSurface(text, &(SDL_Rect){0,0,kMaxTextWidth,text->h}, screen, &(SDL_Rect){16+1,38+y+6+2,0,0});
-					SDL_FreeSurface(text);
-					
-					text = TTF_RenderUTF8_Blended(font, name, color);
-					SDL_BlitSurface(text, &(SDL_Rect){0,0,kMaxTextWidth,text->h}, screen, &(SDL_Rect){16,38+y+6,0,0});
-					SDL_FreeSurface(text);
-				}
-				else {
-					if (entry->conflict) {
-						text = TTF_RenderUTF8_Blended(font, fullname, (SDL_Color){0x66,0x66,0x66});
-						SDL_BlitSurface(text, &(SDL_Rect){0,0,kMaxTextWidth,text->h}, screen, &(SDL_Rect){16,38+y+6,0,0});
-						SDL_FreeSurface(text);
-					}
-					
-					text = TTF_RenderUTF8_Blended(font, entry->name, color);
-					SDL_BlitSurface(text, &(SDL_Rect){0,0,kMaxTextWidth,text->h}, screen, &(SDL_Rect){16,38+y+6,0,0});
-					SDL_FreeSurface(text);
-				}
-				
-				y += 32;
-			}
-			
-			SDL_Flip(screen);
+		Latency_mark(&latency_pending, kLatencyUpdate);
+		
+		// while a held direction races through the list only the latest position matters, so
+		// frames the render thread is still busy for are skipped instead of captured and dropped
+		// and nothing is prewarmed until the selection settles
+		int is_repeating = Input_isRepeating(SDL_GetTicks());
+		if (was_repeating && !is_repeating) prewarm_selected();
+		was_repeating = is_repeating;
+		if (is_dirty && is_repeating && Render_isBusy()) {
+			// still dirty next frame
+		}
+		else if (is_dirty) {
+			if (!is_repeating) prewarm_selected();
+			View_capture(&view, ++generation, show_setting, setting_value, setting_max, scroll_ox);
+			Render_publish(&view);
 			is_dirty = 0;
+			did_publish = 1;
 		}
-		
-		if (needs_scrolling && is_scrolling) {
-			SDL_Surface* text;
-			int i = top->selected;
-			int y = 32 * (i - top->start);
-			
-			Entry* entry = top->entries->items[i];
-			char* fullname = strrchr(entry->path, '/')+1;
-			char* name = entry->conflict ? fullname : entry->name;
-			
-			text = TTF_RenderUTF8_Blended(font, name, (SDL_Color){0x68,0x5a,0x35});
-			if (text->w-scroll_ox>kMaxTextWidth) {
-				// bar
-				SDL_BlitSurface(ui_highlight_bar, NULL, screen, &(SDL_Rect){0,38+y,0,0});
-			
-				// shadow
-				// NOTE: text creation moved outside conditional
-				SDL_BlitSurface(text, &(SDL_Rect){scroll_ox,0,kMaxTextWidth,text->h}, screen, &(SDL_Rect){16+1,38+y+6+2,kMaxTextWidth,text->h});
-				SDL_FreeSurface(text);
-			
-				text = TTF_RenderUTF8_Blended(font, name, color);
-				SDL_BlitSurface(text, &(SDL_Rect){scroll_ox,0,kMaxTextWidth,text->h}, screen, &(SDL_Rect){16,38+y+6,kMaxTextWidth,text->h});
-				SDL_FreeSurface(text);
-				SDL_Flip(screen); // TODO: just update the modified rect?
-			}
-			else {
-				needs_scrolling = 0;
-				SDL_FreeSurface(text);
+		else {
+			Latency_cancel(&latency_pending);
+			if (is_scrolling && Render_needsScrolling()) {
+				view.scroll_ox = scroll_ox;
+				Render_publish(&view);
+				did_publish = 1;
 			}
 		}
 		
-		// slow down to 60fps
-		unsigned long frame_duration = SDL_GetTicks() - frame_start; // 0-1 on non-dirty frames, 11-12 on dirty ones
-		// printf("frame_duration:%lu\n", frame_duration);
+		Profiler_endInput(did_publish);
+		
+		if (memory_requested) {
+			memory_requested = 0;
+			Memory_report("requested");
+		}
+		
+		// poll at a steady 60fps, drawing happens on the render thread
+		unsigned long frame_duration = SDL_GetTicks() - frame_start;
 		#define kTargetFrameDuration 17
 		if (frame_duration<kTargetFrameDuration) SDL_Delay(kTargetFrameDuration-frame_duration);
 	}
 	
+	Memory_report("exit");
+	Prewarm_quit();
+	Render_quit();
+	
 	// one last wipe
-	SDL_FillRect(screen, NULL, 0);
+	Blit_fill(screen, NULL, 0);
 	SDL_Flip(screen);
 	
 	Menu_quit();
+	State_close();
+	Latency_quit();
+	Profiler_quit();
+	KeyShm_close(keyshm);
 	
 	// Mix_FreeChunk(click);
 	// Mix_CloseAudio();
 	// Mix_Quit();
 	
-	SDL_FreeSurface(ui_logo);
-	SDL_FreeSurface(ui_highlight_bar);
-	SDL_FreeSurface(ui_top_bar);
-	SDL_FreeSurface(ui_bottom_bar);
-	SDL_FreeSurface(ui_browse_icon);
-	SDL_FreeSurface(ui_round_button);
-	SDL_FreeSurface(ui_menu_icon);
-	SDL_FreeSurface(ui_start_icon);
-	SDL_FreeSurface(ui_power_0_icon);
-	SDL_FreeSurface(ui_power_20_icon);
-	SDL_FreeSurface(ui_power_50_icon);
-	SDL_FreeSurface(ui_power_80_icon);
-	SDL_FreeSurface(ui_power_100_icon);
-	
-	SDL_FreeSurface(ui_settings_bar_empty);
-	SDL_FreeSurface(ui_settings_bar_full);
-	SDL_FreeSurface(ui_brightness_icon);
-	SDL_FreeSurface(ui_volume_icon);
-	SDL_FreeSurface(ui_mute_icon);
-	
-	TTF_CloseFont(font);
-	TTF_CloseFont(tiny);
 	
 	// both for compatibility pre and post 1.7
 	putenv("trimui_show=no");
@@ -1650,6 +1955,11 @@ int main(void) {
 	
 	QuitSettings();
 
+	setPowerState(POWER_GAME); // or whatever pak MinUI is exiting for
+	PowerStats_quit(&power);
+	Sampler_quit();
+	Timeline_mark("minui_exit", NULL);
+	
 	// fflush(stdout);
 	// fclose(stdout);
 	return 0;
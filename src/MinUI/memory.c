@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+
+#include <unistd.h>
+
+#include "library.h"
+#include "memory.h"
+
+///////////////////////////////////////
+
+#define kMemoryPath kRootDir "/.minui/logs/memory.txt"
+
+static char* memory_names[kMemoryKindCount] = {
+	"entries",
+	"lists",
+	"directories",
+	"paths",
+	"sprites",
+	"fonts",
+};
+
+// fonts can fall back to SDL_ttf on the render thread so these are updated atomically
+static long memory_current[kMemoryKindCount];
+static long memory_peak[kMemoryKindCount];
+static long memory_allocs[kMemoryKindCount];
+
+void Memory_add(int kind, long bytes) {
+	long current = __sync_add_and_fetch(&memory_current[kind], bytes);
+	if (bytes>0) __sync_add_and_fetch(&memory_allocs[kind], 1);
+	long peak = memory_peak[kind];
+	while (current>peak && !__sync_bool_compare_and_swap(&memory_peak[kind], peak, current)) {
+		peak = memory_peak[kind];
+	}
+}
+
+long Memory_heapInUse(void) {
+#if defined(__GLIBC__) && !defined(__UCLIBC__) && (__GLIBC__>2 || (__GLIBC__==2 && __GLIBC_MINOR__>=33))
+	return mallinfo2().uordblks;
+#else
+	return mallinfo().uordblks;
+#endif
+}
+
+void Memory_report(char* reason) {
+	FILE* file = fopen(kMemoryPath, "w"); // only the latest report is kept
+	if (!file) return;
+
+	fprintf(file, "memory (%s)\n", reason);
+	fprintf(file, "  %-12s %10s %10s %10s\n", "subsystem", "current", "peak", "allocs");
+	long total = 0;
+	for (int i=0; i<kMemoryKindCount; i++) {
+		total += memory_current[i];
+		fprintf(file, "  %-12s %8liKB %8liKB %10li\n", memory_names[i], memory_current[i] / 1024, memory_peak[i] / 1024, memory_allocs[i]);
+	}
+	fprintf(file, "  %-12s %8liKB\n", "accounted", total / 1024);
+	fprintf(file, "  %-12s %8liKB\n", "heap", Memory_heapInUse() / 1024);
+
+	// size resident shared text lib data dt, in pages
+	long size = 0;
+	long resident = 0;
+	long shared = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm) {
+		if (fscanf(statm, "%li %li %li", &size, &resident, &shared)!=3) size = resident = shared = 0;
+		fclose(statm);
+	}
+	long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+	fprintf(file, "  %-12s %8liKB (%liKB shared)\n", "rss", resident * page_kb, shared * page_kb);
+	fprintf(file, "  %-12s %8liKB\n", "vm", size * page_kb);
+	fclose(file);
+}
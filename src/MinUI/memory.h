@@ -0,0 +1,23 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+// running byte counts for each of MinUI's long lived allocations, with peaks,
+// reported alongside the whole heap and RSS to .minui/logs/memory.txt
+// on exit and whenever MinUI gets SIGUSR1 (eg. `killall -USR1 MinUI`)
+// has no SDL dependency so the library benchmark can link it too
+
+enum MemoryKind {
+	kMemoryEntries, // Entry structs and their display names
+	kMemoryLists, // Array storage: directory listings, the stack, recents
+	kMemoryDirectories, // Directory structs, alpha indexes and path lookups
+	kMemoryPaths, // the interned path table
+	kMemorySprites, // decoded UI images
+	kMemoryFonts, // glyph atlases and any SDL_ttf fallback
+	kMemoryKindCount,
+};
+
+void Memory_add(int kind, long bytes); // negative when released
+long Memory_heapInUse(void); // everything malloc() currently has handed out
+void Memory_report(char* reason);
+
+#endif
@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <SDL/SDL.h>
+
+#include "../timeline/timeline.h"
+#include "library.h"
+#include "prewarm.h"
+
+///////////////////////////////////////
+
+#define kPrewarmDelay 400 // ms the selection has to be still before reading anything
+#define kPrewarmBudget (32 * 1024 * 1024) // bytes, never more than half of available memory
+#define kPrewarmChunk (256 * 1024) // bytes per readahead(), also how long a move can take to cancel
+
+static SDL_Thread* prewarm_thread;
+static SDL_mutex* prewarm_mutex;
+static SDL_cond* prewarm_wake; // the selection changed
+static char prewarm_path[256]; // guarded by prewarm_mutex
+static int prewarm_generation = 0; // bumped by every new selection
+static unsigned long prewarm_selected_at = 0;
+static int prewarm_quit = 0;
+
+static int isCurrent(int generation) {
+	SDL_LockMutex(prewarm_mutex);
+	int current = generation==prewarm_generation && !prewarm_quit;
+	SDL_UnlockMutex(prewarm_mutex);
+	return current;
+}
+
+static long getBudget(void) {
+	FILE* file = fopen("/proc/meminfo", "r");
+	if (!file) return kPrewarmBudget;
+
+	// older kernels don't have MemAvailable
+	long available = -1;
+	long reclaimable = 0;
+	char line[128];
+	while (fgets(line, sizeof(line), file)) {
+		char key[64];
+		long value;
+		if (sscanf(line, "%63[^:]: %ld", key, &value)!=2) continue;
+		if (!strcmp(key, "MemAvailable")) available = value;
+		else if (!strcmp(key, "MemFree") || !strcmp(key, "Buffers") || !strcmp(key, "Cached")) reclaimable += value;
+	}
+	fclose(file);
+
+	if (available<0) available = reclaimable;
+	long budget = available * 1024 / 2;
+	return budget<kPrewarmBudget ? budget : kPrewarmBudget;
+}
+
+///////////////////////////////////////
+
+// returns 0 once the selection moved or the budget ran out
+static int warm(char* path, int generation, long* budget) {
+	if (*budget<=0 || !isCurrent(generation)) return 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd<0) return 1;
+
+	struct stat st;
+	if (fstat(fd, &st)==0 && S_ISREG(st.st_mode)) {
+		// a rom bigger than what's left still gets its beginning warmed
+		long size = st.st_size<*budget ? st.st_size : *budget;
+		for (long offset=0; offset<size; offset+=kPrewarmChunk) {
+			if (!isCurrent(generation)) {
+				close(fd);
+				return 0;
+			}
+			long count = size-offset<kPrewarmChunk ? size-offset : kPrewarmChunk;
+			readahead(fd, offset, count); // blocks until read so chunks pace themselves
+		}
+		*budget -= size;
+	}
+	close(fd);
+	return *budget>0;
+}
+
+// the binary named by EMU_EXE= in the pak's launch.sh
+static int getEmuExe(char* pak_path, char* exe_path) {
+	char launch_path[256];
+	sprintf(launch_path, "%s/launch.sh", pak_path);
+	FILE* file = fopen(launch_path, "r");
+	if (!file) return 0;
+
+	int found = 0;
+	char line[256];
+	while (!found && fgets(line, sizeof(line), file)) {
+		if (strncmp(line, "EMU_EXE=", 8)) continue;
+		char* exe = line + 8;
+		exe[strcspn(exe, "\r\n \t")] = '\0';
+		if (!*exe) continue;
+		sprintf(exe_path, "%s/%s", pak_path, exe);
+		found = 1;
+	}
+	fclose(file);
+	return found;
+}
+
+static int isSupportFile(char* name) {
+	return strstr(name, ".so") || strcasestr(name, "bios");
+}
+
+// libraries and bios files in the pak and its bios folder
+static int warmSupportFiles(char* dir_path, int is_bios_dir, int generation, long* budget) {
+	DIR* dh = opendir(dir_path);
+	if (!dh) return 1;
+
+	int keep_going = 1;
+	struct dirent* dp;
+	while (keep_going && (dp = readdir(dh))) {
+		if (dp->d_name[0]=='.') continue;
+
+		char path[256];
+		snprintf(path, sizeof(path), "%s/%s", dir_path, dp->d_name);
+		if (!is_bios_dir && !strcasecmp(dp->d_name, "bios")) {
+			keep_going = warmSupportFiles(path, 1, generation, budget);
+		}
+		else if (is_bios_dir || isSupportFile(dp->d_name)) {
+			keep_going = warm(path, generation, budget);
+		}
+	}
+	closedir(dh);
+	return keep_going;
+}
+
+// the cue itself then each FILE it references
+static int warmCue(char* cue_path, int generation, long* budget) {
+	if (!warm(cue_path, generation, budget)) return 0;
+
+	FILE* file = fopen(cue_path, "r");
+	if (!file) return 1;
+
+	char dir_path[256];
+	strcpy(dir_path, cue_path);
+	strrchr(dir_path, '/')[0] = '\0';
+
+	int keep_going = 1;
+	char line[256];
+	while (keep_going && fgets(line, sizeof(line), file)) {
+		char* name = strchr(line, '"');
+		if (!strstr(line, "FILE") || !name) continue;
+		name += 1;
+		char* end = strchr(name, '"');
+		if (!end) continue;
+		*end = '\0';
+
+		char path[256];
+		snprintf(path, sizeof(path), "%s/%s", dir_path, name);
+		keep_going = warm(path, generation, budget);
+	}
+	fclose(file);
+	return keep_going;
+}
+
+static void Prewarm_run(char* rom_path, int generation) {
+	char emu_name[256];
+	strcpy(emu_name, rom_path + strlen(kRomsDir));
+	char* slash = strchr(emu_name, '/');
+	if (!slash) return;
+	*slash = '\0';
+
+	char pak_path[256];
+	sprintf(pak_path, "%s%s.pak", kEmusDir, emu_name);
+
+	// in the order the launch reads them
+	long budget = getBudget();
+	char exe_path[256];
+	if (getEmuExe(pak_path, exe_path) && !warm(exe_path, generation, &budget)) return;
+	if (!warmSupportFiles(pak_path, 0, generation, &budget)) return;
+	if (strlen(rom_path)>4 && match_suffix(".cue", rom_path)) warmCue(rom_path, generation, &budget);
+	else warm(rom_path, generation, &budget);
+
+	if (isCurrent(generation)) Timeline_mark("prewarm", emu_name);
+}
+
+static int Prewarm_thread(void* unused) {
+	int handled = 0; // generation last run (or skipped)
+	char path[256];
+
+	SDL_LockMutex(prewarm_mutex);
+	while (!prewarm_quit) {
+		if (handled==prewarm_generation) {
+			SDL_CondWait(prewarm_wake, prewarm_mutex);
+			continue;
+		}
+
+		unsigned long still = SDL_GetTicks() - prewarm_selected_at;
+		if (still<kPrewarmDelay) {
+			SDL_CondWaitTimeout(prewarm_wake, prewarm_mutex, kPrewarmDelay - still);
+			continue;
+		}
+
+		handled = prewarm_generation;
+		strcpy(path, prewarm_path);
+		SDL_UnlockMutex(prewarm_mutex);
+
+		if (path[0]) Prewarm_run(path, handled);
+
+		SDL_LockMutex(prewarm_mutex);
+	}
+	SDL_UnlockMutex(prewarm_mutex);
+	return 0;
+}
+
+///////////////////////////////////////
+
+void Prewarm_init(void) {
+	prewarm_path[0] = '\0';
+	prewarm_mutex = SDL_CreateMutex();
+	prewarm_wake = SDL_CreateCond();
+	prewarm_thread = SDL_CreateThread(Prewarm_thread, NULL);
+}
+void Prewarm_select(char* rom_path) {
+	SDL_LockMutex(prewarm_mutex);
+	if (!exact_match(prewarm_path, rom_path)) {
+		strcpy(prewarm_path, rom_path);
+		prewarm_generation += 1;
+		prewarm_selected_at = SDL_GetTicks();
+		SDL_CondSignal(prewarm_wake);
+	}
+	SDL_UnlockMutex(prewarm_mutex);
+}
+void Prewarm_quit(void) {
+	SDL_LockMutex(prewarm_mutex);
+	prewarm_quit = 1;
+	SDL_CondSignal(prewarm_wake);
+	SDL_UnlockMutex(prewarm_mutex);
+	SDL_WaitThread(prewarm_thread, NULL);
+
+	SDL_DestroyCond(prewarm_wake);
+	SDL_DestroyMutex(prewarm_mutex);
+}
@@ -0,0 +1,14 @@
+#ifndef PREWARM_H
+#define PREWARM_H
+
+// pulls what launching the selected rom will read into the page cache before A is pressed:
+// the emulator binary, the libraries and bios files in its pak, then the rom itself
+// starts once the selection has been still for a moment, stops as soon as it moves and
+// never reads more than a budget derived from available memory
+
+void Prewarm_init(void);
+// input thread, rom_path is the file open_rom() would launch or an empty string for nothing
+void Prewarm_select(char* rom_path);
+void Prewarm_quit(void);
+
+#endif
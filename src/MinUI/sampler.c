@@ -0,0 +1,157 @@
+#define _GNU_SOURCE // dladdr()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <link.h>
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+
+#include "library.h"
+#include "sampler.h"
+
+///////////////////////////////////////
+
+#define kSamplerEnablePath kRootDir "/.minui/enable-sampler"
+#define kSamplerPath kRootDir "/.minui/logs/sampler.txt"
+#define kSamplerRate 99 // Hz when enable-sampler is empty, off beat with the 60fps loop
+#define kSamplerMaxRate 1000 // the kernel rounds the interval up to its tick anyway
+#define kSamplerCapacity 4096 // samples, about 280KB
+#define kSamplerDepth 18
+#define kSamplerSkip 2 // the handler itself and the signal return trampoline
+
+typedef struct Sample {
+	int tid;
+	int depth;
+	void* frames[kSamplerDepth];
+} Sample;
+
+static Sample* samples = NULL;
+static volatile uint32_t sample_count = 0; // ever taken, the next goes to sample_count % kSamplerCapacity
+static int sampler_rate = 0;
+static int main_tid = 0;
+
+static int getThreadId(void) {
+	return syscall(SYS_gettid);
+}
+
+// SIGPROF is sent to whichever thread was running, this has to be async-signal-safe
+static void sampler_handler(int sig) {
+	int saved_errno = errno;
+	Sample* sample = &samples[__sync_fetch_and_add(&sample_count, 1) % kSamplerCapacity];
+	sample->tid = getThreadId();
+	sample->depth = backtrace(sample->frames, kSamplerDepth);
+	errno = saved_errno;
+}
+
+void Sampler_init(void) {
+	FILE* file = fopen(kSamplerEnablePath, "r");
+	if (!file) return;
+	int rate = 0;
+	if (fscanf(file, "%i", &rate)!=1 || rate<=0) rate = kSamplerRate;
+	fclose(file);
+	if (rate>kSamplerMaxRate) rate = kSamplerMaxRate;
+
+	samples = calloc(kSamplerCapacity, sizeof(Sample)); // the handler never allocates
+	if (!samples) return;
+	main_tid = getThreadId();
+
+	// the first backtrace() dlopen()s libgcc_s, which mustn't happen in the handler
+	void* warm[1];
+	backtrace(warm, 1);
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sampler_handler;
+	sa.sa_flags = SA_RESTART; // don't turn every sample into an EINTR somewhere
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGPROF, &sa, NULL);
+
+	// ITIMER_PROF only counts CPU time so an idle menu costs nothing
+	struct itimerval timer;
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = 1000000 / rate;
+	timer.it_value = timer.it_interval;
+	if (setitimer(ITIMER_PROF, &timer, NULL)!=0) {
+		signal(SIGPROF, SIG_DFL);
+		free(samples);
+		samples = NULL;
+		return;
+	}
+	sampler_rate = rate;
+}
+
+///////////////////////////////////////
+
+// module+offset, which addr2line -f -e <module> resolves on the build machine, even for
+// static functions, dladdr() only knows the few symbols -rdynamic exports
+static void getFrameName(void* address, char* name, int size) {
+	Dl_info info;
+	if (!dladdr(address, &info) || !info.dli_fname) {
+		snprintf(name, size, "%p", address);
+		return;
+	}
+	// a non-PIE executable is linked at its runtime address, anything else is relative to its base
+	uintptr_t offset = (uintptr_t)address;
+	if (((ElfW(Ehdr)*)info.dli_fbase)->e_type!=ET_EXEC) offset -= (uintptr_t)info.dli_fbase;
+	char* base = strrchr(info.dli_fname, '/');
+	snprintf(name, size, "%s+0x%lx", base ? base+1 : info.dli_fname, (unsigned long)offset);
+}
+
+// one line per stack, outermost frame first: thread;caller;...;callee
+static char* foldSample(Sample* sample) {
+	char stack[kSamplerDepth * 64 + 32];
+	int length;
+	if (sample->tid==main_tid) length = sprintf(stack, "main");
+	else length = sprintf(stack, "thread-%i", sample->tid);
+	for (int i=sample->depth-1; i>=kSamplerSkip; i--) {
+		char name[64];
+		// callers' frames are return addresses, step back into the call so it resolves to its line
+		getFrameName((char*)sample->frames[i] - (i>kSamplerSkip), name, sizeof(name));
+		length += snprintf(stack+length, sizeof(stack)-length, ";%s", name);
+		if (length>=sizeof(stack)) break;
+	}
+	return copy_string(stack);
+}
+
+static int compareStacks(const void* a, const void* b) {
+	return strcmp(*(char**)a, *(char**)b);
+}
+
+void Sampler_quit(void) {
+	if (!samples) return;
+
+	struct itimerval timer;
+	memset(&timer, 0, sizeof(timer));
+	setitimer(ITIMER_PROF, &timer, NULL);
+	signal(SIGPROF, SIG_IGN); // one may still be pending
+
+	int count = sample_count<kSamplerCapacity ? sample_count : kSamplerCapacity;
+	char** stacks = malloc(count * sizeof(char*));
+	int folded = 0;
+	for (int i=0; i<count; i++) {
+		if (samples[i].depth>kSamplerSkip) stacks[folded++] = foldSample(&samples[i]);
+	}
+	qsort(stacks, folded, sizeof(char*), compareStacks);
+
+	FILE* file = fopen(kSamplerPath, "w");
+	for (int i=0; i<folded; ) {
+		int j = i+1;
+		while (j<folded && exact_match(stacks[i], stacks[j])) j += 1;
+		if (file) fprintf(file, "%s %i\n", stacks[i], j-i);
+		i = j;
+	}
+	if (file) fclose(file);
+	printf("sampler: %u samples at %iHz, %u overwritten, folded into %s\n", sample_count, sampler_rate, sample_count-count, kSamplerPath);
+
+	for (int i=0; i<folded; i++) free(stacks[i]);
+	free(stacks);
+	free(samples);
+	samples = NULL;
+}
@@ -0,0 +1,15 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+// opt-in sampling profiler for finding hot spots on the device itself
+// enabled by .minui/enable-sampler, which may hold a rate in Hz (eg. `echo 250 > enable-sampler`)
+// setitimer(ITIMER_PROF) sends SIGPROF as MinUI burns CPU, whichever thread is running
+// backtrace()s into a preallocated ring (the newest samples win), nothing else happens in the handler
+// on quit the stacks are folded into .minui/logs/sampler.txt, ready for flamegraph.pl or speedscope
+// frames are recorded as module+offset: `make` keeps an unstripped MinUI.debug next to the stripped
+// MinUI so `addr2line -f -e MinUI.debug 0x1a2c` names any MinUI frame, static functions included
+
+void Sampler_init(void);
+void Sampler_quit(void); // stops sampling and writes the folded stacks
+
+#endif
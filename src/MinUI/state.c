@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <zlib.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "library.h"
+#include "state.h"
+
+///////////////////////////////////////
+
+#define kStatePath kRootDir "/.minui/state.bin"
+#define kStateSlotSize (16 * 1024) // kMaxRecents full length paths still fit
+#define kStateMagic 0x54534e4d // MNST
+
+typedef struct StateSlot {
+	uint32_t magic;
+	uint32_t crc; // of everything after it
+	uint32_t sequence; // the slot with the higher one is current
+	uint32_t length; // of data
+	uint8_t data[]; // records: uint16_t key, uint16_t length, then that many bytes
+} StateSlot;
+
+#define kStateDataSize (kStateSlotSize - sizeof(StateSlot))
+
+// the store's old single value files, imported once
+static char* legacy_paths[kStateKeyCount] = {
+	kRootDir "/.minui/recent.txt",
+	kRootDir "/.minui/screenshots.txt",
+};
+
+static int state_fd = -1;
+static uint8_t* state_map = NULL; // both slots
+static int state_current = -1; // slot holding the last commit
+static uint32_t state_sequence = 0;
+static char* state_values[kStateKeyCount];
+static int state_dirty = 0;
+
+static StateSlot* getSlot(int i) {
+	return (StateSlot*)(state_map + i * kStateSlotSize);
+}
+static uint32_t getChecksum(StateSlot* slot) {
+	uint32_t crc = crc32(0L, Z_NULL, 0);
+	return crc32(crc, (uint8_t*)&slot->sequence, sizeof(StateSlot) - offsetof(StateSlot, sequence) + slot->length);
+}
+static int isValid(StateSlot* slot) {
+	return slot->magic==kStateMagic && slot->length<=kStateDataSize && slot->crc==getChecksum(slot);
+}
+
+///////////////////////////////////////
+
+static void load(void) {
+	for (int i=0; i<2; i++) {
+		StateSlot* slot = getSlot(i);
+		if (!isValid(slot)) continue;
+		if (state_current==-1 || slot->sequence>state_sequence) {
+			state_current = i;
+			state_sequence = slot->sequence;
+		}
+	}
+	if (state_current==-1) return;
+
+	StateSlot* slot = getSlot(state_current);
+	uint32_t offset = 0;
+	while (offset+4<=slot->length) {
+		uint16_t key, length;
+		memcpy(&key, slot->data + offset, 2);
+		memcpy(&length, slot->data + offset + 2, 2);
+		offset += 4;
+		if (offset+length>slot->length) break;
+		if (key<kStateKeyCount) { // newer builds may know more keys
+			free(state_values[key]);
+			state_values[key] = malloc(length + 1);
+			memcpy(state_values[key], slot->data + offset, length);
+			state_values[key][length] = '\0';
+		}
+		offset += length;
+	}
+}
+
+static char* readLegacy(char* path) {
+	FILE* file = fopen(path, "r");
+	if (!file) return NULL;
+	fseek(file, 0L, SEEK_END);
+	long size = ftell(file);
+	rewind(file);
+	char* contents = malloc(size + 1);
+	size = fread(contents, 1, size, file);
+	contents[size] = '\0';
+	fclose(file);
+	return contents;
+}
+
+void State_open(void) {
+	state_fd = open(kStatePath, O_RDWR|O_CREAT|O_CLOEXEC, 0644); // not inherited by resident launches
+	struct stat st;
+	if (state_fd>=0 && fstat(state_fd, &st)==0 && (st.st_size==2*kStateSlotSize || ftruncate(state_fd, 2*kStateSlotSize)==0)) {
+		state_map = mmap(NULL, 2*kStateSlotSize, PROT_READ|PROT_WRITE, MAP_SHARED, state_fd, 0);
+		if (state_map==MAP_FAILED) state_map = NULL;
+	}
+	if (state_map) load();
+	else puts("state store unavailable, nothing will be remembered");
+
+	int imported = 0;
+	for (int i=0; i<kStateKeyCount; i++) {
+		char* contents = readLegacy(legacy_paths[i]);
+		if (!contents) continue;
+		State_set(i, contents);
+		free(contents);
+		imported = 1;
+	}
+	if (imported && State_commit()) {
+		for (int i=0; i<kStateKeyCount; i++) unlink(legacy_paths[i]);
+	}
+}
+
+char* State_get(int key) {
+	return state_values[key];
+}
+void State_set(int key, char* value) {
+	if (state_values[key] && value && exact_match(state_values[key], value)) return;
+	free(state_values[key]);
+	state_values[key] = value ? copy_string(value) : NULL;
+	state_dirty = 1;
+}
+
+int State_commit(void) {
+	if (!state_dirty) return 1;
+	if (!state_map) return 0;
+
+	StateSlot* slot = getSlot(state_current==0 ? 1 : 0);
+	uint32_t length = 0;
+	for (int i=0; i<kStateKeyCount; i++) {
+		if (!state_values[i]) continue;
+		uint16_t key = i;
+		size_t size = strlen(state_values[i]);
+		if (size>UINT16_MAX || length+4+size>kStateDataSize) {
+			printf("state %i too large to commit (%i bytes)\n", i, (int)size);
+			return 0;
+		}
+		uint16_t value_length = size;
+		memcpy(slot->data + length, &key, 2);
+		memcpy(slot->data + length + 2, &value_length, 2);
+		memcpy(slot->data + length + 4, state_values[i], size);
+		length += 4 + size;
+	}
+
+	// a write torn anywhere in here fails the checksum and the other slot stays current
+	slot->sequence = state_sequence + 1;
+	slot->length = length;
+	slot->crc = getChecksum(slot);
+	slot->magic = kStateMagic;
+
+	// dirty mmapped pages belong to the file so this flushes just them, not the whole card
+	if (fdatasync(state_fd)!=0) {
+		puts("state commit could not be synced");
+		return 0;
+	}
+	state_current = state_current==0 ? 1 : 0;
+	state_sequence += 1;
+	state_dirty = 0;
+	return 1;
+}
+
+void State_close(void) {
+	State_commit();
+	if (state_map) munmap(state_map, 2*kStateSlotSize);
+	if (state_fd>=0) close(state_fd);
+	state_map = NULL;
+	state_fd = -1;
+	state_current = -1;
+	state_sequence = 0;
+	for (int i=0; i<kStateKeyCount; i++) {
+		free(state_values[i]);
+		state_values[i] = NULL;
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef STATE_H
+#define STATE_H
+
+// everything MinUI remembers across launches, in one small mmapped file on the card
+// a commit goes to the older of two slots with a checksum and the next sequence number
+// then fdatasync()s just that file, a torn write leaves the previous commit in place
+// has no SDL dependency so the library benchmark can link it too
+
+enum StateKey {
+	kStateRecents, // newline separated paths, newest first
+	kStateScreenshots, // number of the last screenshot taken
+	kStateKeyCount,
+};
+
+void State_open(void); // imports (then removes) the old recent.txt and screenshots.txt
+char* State_get(int key); // NULL when unset, owned by the store
+void State_set(int key, char* value); // held in memory until the next commit
+int State_commit(void); // returns 0 if pending changes couldn't be made durable
+void State_close(void); // commits anything pending
+
+#endif
@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text.h"
+#include "blit.h"
+#include "memory.h"
+
+///////////////////////////////////////
+
+typedef struct FallbackGlyph { // a glyph missing from the atlas, as SDL_ttf renders it
+	AtlasGlyph glyph; // x and y are unused
+	uint8_t* coverage; // w*h
+} FallbackGlyph;
+
+static void* load_file(char* path, long* size_out) {
+	FILE* file = fopen(path, "rb");
+	if (!file) return NULL;
+	fseek(file, 0L, SEEK_END);
+	size_t size = ftell(file);
+	rewind(file);
+	void* data = malloc(size);
+	if (data && fread(data, 1, size, file)!=size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(file);
+	if (data) *size_out = size;
+	return data;
+} // NOTE: caller must free() result!
+
+// SDL_ttf's allocations are opaque so measure what opening the face cost the heap
+static TTF_Font* open_ttf(Font* self) {
+	long before = Memory_heapInUse();
+	TTF_Font* ttf = TTF_OpenFont(self->path, self->size);
+	self->ttf_bytes = ttf ? Memory_heapInUse() - before : 0;
+	Memory_add(kMemoryFonts, self->ttf_bytes);
+	return ttf;
+}
+
+// returns the next codepoint and advances str, malformed bytes decode as 0xfffd
+static uint32_t next_codepoint(unsigned char** str) {
+	unsigned char* s = *str;
+	uint32_t c = *s++;
+	int extra = 0;
+	if (c>=0xf0) { c &= 0x07; extra = 3; }
+	else if (c>=0xe0) { c &= 0x0f; extra = 2; }
+	else if (c>=0xc0) { c &= 0x1f; extra = 1; }
+	else if (c>=0x80) c = 0xfffd;
+	while (extra--) {
+		if ((*s & 0xc0)!=0x80) {
+			c = 0xfffd;
+			break;
+		}
+		c = (c<<6) | (*s++ & 0x3f);
+	}
+	*str = s;
+	return c;
+}
+
+///////////////////////////////////////
+
+Font* Font_open(char* path, char* atlas_path, int size) {
+	Font* self = malloc(sizeof(Font));
+	memset(self, 0, sizeof(Font));
+	self->path = path;
+	self->size = size;
+	memset(self->lookup, -1, sizeof(self->lookup));
+	
+	self->data = load_file(atlas_path, &self->data_bytes);
+	if (self->data) {
+		AtlasHeader* header = self->data;
+		if (header->magic!=ATLAS_MAGIC || header->version!=ATLAS_VERSION || header->size!=size) {
+			printf("ignoring stale atlas %s\n", atlas_path);
+			free(self->data);
+			self->data = NULL;
+		}
+	}
+	if (self->data) {
+		self->header = self->data;
+		self->glyphs = (AtlasGlyph*)(self->header + 1);
+		self->kerns = (AtlasKern*)(self->glyphs + self->header->glyph_count);
+		self->coverage = (uint8_t*)(self->kerns + self->header->kern_count);
+		for (int i=0; i<self->header->glyph_count; i++) {
+			uint32_t c = self->glyphs[i].codepoint;
+			if (c<256) self->lookup[c] = i;
+		}
+	}
+	else self->ttf = open_ttf(self);
+	
+	if (!self->data) self->data_bytes = 0;
+	Memory_add(kMemoryFonts, sizeof(Font) + self->data_bytes);
+	
+	return self;
+}
+void Font_close(Font* self) {
+	long bytes = sizeof(Font) + self->data_bytes + self->ttf_bytes + self->fallback_capacity * sizeof(FallbackGlyph);
+	for (int i=0; i<self->fallback_count; i++) {
+		AtlasGlyph* glyph = &self->fallback[i].glyph;
+		bytes += glyph->w * glyph->h;
+		free(self->fallback[i].coverage);
+	}
+	Memory_add(kMemoryFonts, -bytes);
+	if (self->ttf) TTF_CloseFont(self->ttf);
+	free(self->fallback);
+	free(self->data);
+	free(self);
+}
+
+void Font_trim(Font* self) {
+	if (!self->ttf) return;
+	TTF_CloseFont(self->ttf);
+	self->ttf = NULL;
+	Memory_add(kMemoryFonts, -self->ttf_bytes);
+	self->ttf_bytes = 0;
+}
+
+static TTF_Font* Font_ttf(Font* self) {
+	if (!self->ttf) self->ttf = open_ttf(self);
+	return self->ttf;
+}
+
+// renders c the way TTF_RenderUTF8_Blended() draws it mid-string, cropped to its ink
+// a one codepoint string rather than TTF_RenderGlyph_Blended(), whose surface is the bare bitmap in
+// SDL_ttf 2.0 but a whole line in later versions, a string's rows are always the line's and its pen
+// starts -minx in when the glyph hangs off the left edge
+static void Font_renderFallback(Font* self, uint32_t c, FallbackGlyph* fallback) {
+	memset(fallback, 0, sizeof(FallbackGlyph));
+	fallback->glyph.codepoint = c;
+	
+	TTF_Font* ttf = Font_ttf(self);
+	int minx,maxx,miny,maxy,advance;
+	if (!ttf || c>0xffff || TTF_GlyphMetrics(ttf, c, &minx,&maxx,&miny,&maxy,&advance)) return;
+	fallback->glyph.advance = advance;
+	
+	char str[4];
+	if (c<0x80) { str[0] = c; str[1] = '\0'; }
+	else if (c<0x800) { str[0] = 0xc0 | (c>>6); str[1] = 0x80 | (c & 0x3f); str[2] = '\0'; }
+	else { str[0] = 0xe0 | (c>>12); str[1] = 0x80 | ((c>>6) & 0x3f); str[2] = 0x80 | (c & 0x3f); str[3] = '\0'; }
+	SDL_Surface* text = TTF_RenderUTF8_Blended(ttf, str, (SDL_Color){0xff,0xff,0xff});
+	if (!text) return;
+	
+	SDL_PixelFormat* format = text->format;
+	SDL_LockSurface(text);
+	#define ALPHA(x,y) ((((uint32_t*)((uint8_t*)text->pixels + (y) * text->pitch))[x] & format->Amask) >> format->Ashift)
+	int x0 = text->w;
+	int y0 = text->h;
+	int x1 = 0;
+	int y1 = 0;
+	for (int y=0; y<text->h; y++) {
+		for (int x=0; x<text->w; x++) {
+			if (!ALPHA(x,y)) continue;
+			if (x<x0) x0 = x;
+			if (x>=x1) x1 = x + 1;
+			if (y<y0) y0 = y;
+			if (y>=y1) y1 = y + 1;
+		}
+	}
+	if (x0<x1 && x1-x0<=255 && y1-y0<=255 && (fallback->coverage = malloc((x1-x0) * (y1-y0)))) {
+		fallback->glyph.w = x1 - x0;
+		fallback->glyph.h = y1 - y0;
+		fallback->glyph.left = x0 - (minx<0 ? -minx : 0);
+		fallback->glyph.top = y0;
+		for (int y=y0; y<y1; y++) {
+			uint8_t* dst = fallback->coverage + (y - y0) * fallback->glyph.w;
+			for (int x=x0; x<x1; x++) {
+				dst[x-x0] = ALPHA(x,y);
+			}
+		}
+	}
+	#undef ALPHA
+	SDL_UnlockSurface(text);
+	SDL_FreeSurface(text);
+}
+
+// the cached rendering of a codepoint the atlas doesn't have, rendered on first use
+static FallbackGlyph* Font_fallback(Font* self, uint32_t c) {
+	int lo = 0;
+	int hi = self->fallback_count - 1;
+	while (lo<=hi) {
+		int mid = (lo + hi) / 2;
+		uint32_t codepoint = self->fallback[mid].glyph.codepoint;
+		if (codepoint==c) return &self->fallback[mid];
+		if (codepoint<c) lo = mid + 1;
+		else hi = mid - 1;
+	}
+	
+	if (self->fallback_count==self->fallback_capacity) {
+		int capacity = self->fallback_capacity ? self->fallback_capacity * 2 : 16;
+		self->fallback = realloc(self->fallback, capacity * sizeof(FallbackGlyph));
+		Memory_add(kMemoryFonts, (capacity - self->fallback_capacity) * sizeof(FallbackGlyph));
+		self->fallback_capacity = capacity;
+	}
+	FallbackGlyph* fallback = &self->fallback[lo];
+	memmove(fallback + 1, fallback, (self->fallback_count - lo) * sizeof(FallbackGlyph));
+	self->fallback_count += 1;
+	
+	Font_renderFallback(self, c, fallback);
+	Memory_add(kMemoryFonts, fallback->glyph.w * fallback->glyph.h);
+	return fallback;
+}
+
+static int Font_kerning(Font* self, int left, int right) {
+	int lo = 0;
+	int hi = self->header->kern_count - 1;
+	uint32_t key = (left<<16) | right;
+	while (lo<=hi) {
+		int mid = (lo + hi) / 2;
+		AtlasKern* kern = &self->kerns[mid];
+		uint32_t k = (kern->left<<16) | kern->right;
+		if (k==key) return kern->x;
+		if (k<key) lo = mid + 1;
+		else hi = mid - 1;
+	}
+	return 0;
+}
+
+// walks str the way SDL_ttf lays it out, calling fn for each glyph at its pen position
+// coverage points at the glyph's top left row, pitch bytes apart
+typedef void (*GlyphFunc)(Font* self, AtlasGlyph* glyph, uint8_t* coverage, int pitch, int x, void* userdata);
+static int Font_layout(Font* self, char* str, GlyphFunc fn, void* userdata) {
+	unsigned char* s = (unsigned char*)str;
+	int x = 0;
+	int width = 0;
+	int first = 1;
+	int prior = -1; // atlas index of the previous glyph, -1 after a fallback glyph
+	while (*s) {
+		uint32_t c = next_codepoint(&s);
+		int index = c<256 ? self->lookup[c] : -1;
+		AtlasGlyph* glyph;
+		uint8_t* coverage;
+		int pitch;
+		if (index>=0) {
+			glyph = &self->glyphs[index];
+			pitch = self->header->width;
+			coverage = self->coverage + glyph->y * pitch + glyph->x;
+		}
+		else {
+			FallbackGlyph* fallback = Font_fallback(self, c);
+			glyph = &fallback->glyph;
+			pitch = glyph->w;
+			coverage = fallback->coverage;
+		}
+		
+		// the atlas only has kerning pairs between its own glyphs, those with a fallback glyph are dropped
+		if (prior>=0 && index>=0 && self->header->kern_count) x += Font_kerning(self, prior, index);
+		if (first && glyph->left<0) x -= glyph->left; // SDL_ttf doesn't let the first glyph hang off the left edge
+		
+		if (fn && coverage) fn(self, glyph, coverage, pitch, x, userdata);
+		
+		int right = x + glyph->left + glyph->w;
+		if (x + glyph->advance>right) right = x + glyph->advance;
+		if (right>width) width = right;
+		
+		x += glyph->advance;
+		prior = index;
+		first = 0;
+	}
+	return width;
+}
+
+///////////////////////////////////////
+
+int Font_width(Font* self, char* str) {
+	if (!self->data) {
+		int w = 0;
+		TTF_SizeUTF8(Font_ttf(self), str, &w, NULL);
+		return w;
+	}
+	return Font_layout(self, str, NULL, NULL);
+}
+int Font_height(Font* self) {
+	if (self->data) return self->header->height;
+	return TTF_FontHeight(Font_ttf(self));
+}
+
+typedef struct DrawContext {
+	SDL_Surface* dst;
+	uint16_t color; // RGB565
+	int x; // string origin in dst
+	int y;
+	int min_x; // clip in dst
+	int max_x;
+	int min_y;
+	int max_y;
+} DrawContext;
+
+static void Font_drawGlyph(Font* self, AtlasGlyph* glyph, uint8_t* coverage, int pitch, int x, void* userdata) {
+	DrawContext* ctx = userdata;
+	
+	int gx = ctx->x + x + glyph->left;
+	int gy = ctx->y + glyph->top;
+	int x0 = gx<ctx->min_x ? ctx->min_x : gx;
+	int x1 = gx+glyph->w>ctx->max_x ? ctx->max_x : gx+glyph->w;
+	int y0 = gy<ctx->min_y ? ctx->min_y : gy;
+	int y1 = gy+glyph->h>ctx->max_y ? ctx->max_y : gy+glyph->h;
+	if (x0>=x1 || y0>=y1) return;
+	
+	for (int dy=y0; dy<y1; dy++) {
+		uint8_t* src = coverage + (dy - gy) * pitch + (x0 - gx);
+		uint16_t* dst = (uint16_t*)((uint8_t*)ctx->dst->pixels + dy * ctx->dst->pitch) + x0;
+		Blit_coverage(dst, src, x1 - x0, ctx->color);
+	}
+}
+
+void Font_draw(Font* self, char* str, SDL_Color color, SDL_Surface* dst, int x, int y, int ox, int max_w) {
+	if (!self->data || dst->format->BytesPerPixel!=2) {
+		SDL_Surface* text = TTF_RenderUTF8_Blended(Font_ttf(self), str, color);
+		if (!text) return;
+		SDL_BlitSurface(text, &(SDL_Rect){ox,0,max_w ? max_w : text->w,text->h}, dst, &(SDL_Rect){x,y,0,0});
+		SDL_FreeSurface(text);
+		return;
+	}
+	
+	DrawContext ctx;
+	ctx.dst = dst;
+	ctx.color = RGB565(color.r, color.g, color.b);
+	ctx.x = x - ox;
+	ctx.y = y;
+	
+	// the visible window of the string's surface, intersected with dst's clip rect
+	SDL_Rect* clip = &dst->clip_rect;
+	ctx.min_x = x;
+	ctx.max_x = max_w ? x + max_w : dst->w;
+	ctx.min_y = y;
+	ctx.max_y = y + self->header->height;
+	if (ctx.min_x<clip->x) ctx.min_x = clip->x;
+	if (ctx.max_x>clip->x+clip->w) ctx.max_x = clip->x + clip->w;
+	if (ctx.min_y<clip->y) ctx.min_y = clip->y;
+	if (ctx.max_y>clip->y+clip->h) ctx.max_y = clip->y + clip->h;
+	if (ctx.min_x>=ctx.max_x || ctx.min_y>=ctx.max_y) return;
+	
+	SDL_LockSurface(dst);
+	Font_layout(self, str, Font_drawGlyph, &ctx);
+	SDL_UnlockSurface(dst);
+}
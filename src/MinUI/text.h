@@ -0,0 +1,43 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+// draws UTF-8 strings straight into a 16bpp surface from a baked atlas (see src/fontbake)
+// a glyph the atlas doesn't have is rendered once through SDL_ttf and cached, the rest of its string still
+// comes from the atlas (SDL_ttf 2.0 only takes UCS-2 so codepoints past 0xffff draw as nothing)
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+
+#include "../fontbake/atlas.h"
+
+typedef struct Font {
+	char* path; // for the SDL_ttf fallback
+	int size;
+	TTF_Font* ttf; // opened on first fallback
+	long ttf_bytes; // heap SDL_ttf took to open it, for memory.h
+	
+	void* data; // the whole atlas file, NULL if it couldn't be loaded
+	long data_bytes;
+	AtlasHeader* header;
+	AtlasGlyph* glyphs;
+	AtlasKern* kerns;
+	uint8_t* coverage;
+	int16_t lookup[256]; // codepoint -> glyph index, -1 when missing
+	
+	struct FallbackGlyph* fallback; // sorted by codepoint
+	int fallback_count;
+	int fallback_capacity;
+} Font;
+
+Font* Font_open(char* path, char* atlas_path, int size);
+void Font_close(Font* self);
+void Font_trim(Font* self); // closes the SDL_ttf fallback until a new glyph needs it, cached glyphs stay
+
+int Font_width(Font* self, char* str);
+int Font_height(Font* self);
+// visually equivalent to blitting TTF_RenderUTF8_Blended() with a src rect of {ox,0,max_w,height}
+// to (x,y), coverage is rounded to 0-32 where SDL truncates it to 0-31 so edges can be a step apart
+// pass 0 for max_w to draw the whole string
+void Font_draw(Font* self, char* str, SDL_Color color, SDL_Surface* dst, int x, int y, int ox, int max_w);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+// atlas.h
+// on-disk layout of a baked font atlas, written by fontbake and read by MinUI
+// all fields are native-endian (both the build host and the device are little-endian)
+//
+// file: AtlasHeader, AtlasGlyph[glyph_count], AtlasKern[kern_count], uint8_t coverage[width*height]
+
+#include <stdint.h>
+
+#define ATLAS_MAGIC		0x544e464d // MFNT
+#define ATLAS_VERSION	1
+
+typedef struct AtlasHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint16_t size; // pixel size the font was rasterized at
+	int16_t height; // line height, matches TTF_FontHeight()
+	int16_t ascent; // matches TTF_FontAscent()
+	uint16_t glyph_count;
+	uint32_t kern_count;
+	uint16_t width; // coverage map dimensions
+	uint16_t height_px;
+} AtlasHeader;
+
+typedef struct AtlasGlyph { // sorted by codepoint
+	uint32_t codepoint;
+	uint16_t x; // position in the coverage map
+	uint16_t y;
+	uint8_t w;
+	uint8_t h;
+	int8_t left; // offset from the pen position to the left edge of the bitmap
+	int8_t top; // offset from the top of the line to the top edge of the bitmap
+	int8_t advance;
+	uint8_t unused[3];
+} AtlasGlyph;
+
+typedef struct AtlasKern { // sorted by (left,right)
+	uint16_t left; // glyph indices
+	uint16_t right;
+	int16_t x; // pixels
+} AtlasKern;
+
+#endif
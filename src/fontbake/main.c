@@ -0,0 +1,169 @@
+// fontbake
+// host tool that pre-rasterizes the glyphs MinUI draws into an 8-bit coverage atlas
+// uses the same FreeType calls and rounding as SDL_ttf so metrics line up with TTF_RenderUTF8_Blended()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "atlas.h"
+
+///////////////////////////////////////
+
+// same fixed point helpers SDL_ttf uses
+#define FT_FLOOR(X)	((X & -64) / 64)
+#define FT_CEIL(X)	(((X + 63) & -64) / 64)
+
+#define kAtlasWidth 256
+#define kMaxGlyphs 256
+
+// printable ASCII plus Latin-1, anything else falls back to SDL_ttf at runtime
+static int bakeable(uint32_t c) {
+	return (c>=0x20 && c<0x7f) || (c>=0xa0 && c<=0xff);
+}
+
+///////////////////////////////////////
+
+int main(int argc, char* argv[]) {
+	if (argc<4) {
+		puts("Usage: fontbake font.otf size out.atlas");
+		return 0;
+	}
+	char* font_path = argv[1];
+	int size = atoi(argv[2]);
+	char* out_path = argv[3];
+
+	FT_Library library;
+	FT_Face face;
+	if (FT_Init_FreeType(&library)) {
+		puts("could not init FreeType");
+		return 1;
+	}
+	if (FT_New_Face(library, font_path, 0, &face)) {
+		printf("could not open %s\n", font_path);
+		return 1;
+	}
+	FT_Set_Char_Size(face, 0, size * 64, 0, 0); // 72dpi, so points are pixels (like TTF_OpenFont)
+
+	FT_Fixed scale = face->size->metrics.y_scale;
+	int ascent = FT_CEIL(FT_MulFix(face->ascender, scale));
+	int descent = FT_CEIL(FT_MulFix(face->descender, scale));
+	int height = ascent - descent + 1;
+
+	// rasterize every available glyph
+	AtlasGlyph glyphs[kMaxGlyphs];
+	uint8_t* bitmaps[kMaxGlyphs];
+	int glyph_indices[kMaxGlyphs];
+	int glyph_count = 0;
+	for (uint32_t c=0; c<=0xff; c++) {
+		if (!bakeable(c)) continue;
+		int index = FT_Get_Char_Index(face, c);
+		if (!index && c!=' ') continue; // missing, will fall back
+
+		if (FT_Load_Glyph(face, index, FT_LOAD_DEFAULT)) continue;
+		if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL)) continue;
+
+		FT_GlyphSlot slot = face->glyph;
+		FT_Bitmap* bitmap = &slot->bitmap;
+		FT_Glyph_Metrics* metrics = &slot->metrics;
+
+		AtlasGlyph* glyph = &glyphs[glyph_count];
+		memset(glyph, 0, sizeof(AtlasGlyph));
+		glyph->codepoint = c;
+		glyph->w = bitmap->width;
+		glyph->h = bitmap->rows;
+		glyph->left = FT_FLOOR(metrics->horiBearingX);
+		glyph->top = ascent - FT_FLOOR(metrics->horiBearingY);
+		glyph->advance = FT_CEIL(metrics->horiAdvance);
+
+		uint8_t* pixels = malloc(glyph->w * glyph->h + 1);
+		for (int y=0; y<glyph->h; y++) {
+			memcpy(pixels + y * glyph->w, bitmap->buffer + y * bitmap->pitch, glyph->w);
+		}
+		bitmaps[glyph_count] = pixels;
+		glyph_indices[glyph_count] = index;
+		glyph_count += 1;
+	}
+
+	// shelf pack into a fixed width coverage map
+	int x = 0;
+	int y = 0;
+	int shelf = 0;
+	for (int i=0; i<glyph_count; i++) {
+		AtlasGlyph* glyph = &glyphs[i];
+		if (x+glyph->w>kAtlasWidth) {
+			x = 0;
+			y += shelf;
+			shelf = 0;
+		}
+		glyph->x = x;
+		glyph->y = y;
+		x += glyph->w;
+		if (glyph->h>shelf) shelf = glyph->h;
+	}
+	int atlas_height = y + shelf;
+	uint8_t* coverage = calloc(kAtlasWidth * atlas_height, 1);
+	for (int i=0; i<glyph_count; i++) {
+		AtlasGlyph* glyph = &glyphs[i];
+		for (int row=0; row<glyph->h; row++) {
+			memcpy(coverage + (glyph->y + row) * kAtlasWidth + glyph->x, bitmaps[i] + row * glyph->w, glyph->w);
+		}
+		free(bitmaps[i]);
+	}
+
+	// non-zero kerning pairs, already sorted by (left,right)
+	int kern_capacity = 1024;
+	int kern_count = 0;
+	AtlasKern* kerns = malloc(sizeof(AtlasKern) * kern_capacity);
+	if (FT_HAS_KERNING(face)) {
+		for (int left=0; left<glyph_count; left++) {
+			for (int right=0; right<glyph_count; right++) {
+				FT_Vector delta;
+				FT_Get_Kerning(face, glyph_indices[left], glyph_indices[right], FT_KERNING_DEFAULT, &delta);
+				int kern = delta.x >> 6;
+				if (!kern) continue;
+				if (kern_count==kern_capacity) {
+					kern_capacity *= 2;
+					kerns = realloc(kerns, sizeof(AtlasKern) * kern_capacity);
+				}
+				kerns[kern_count].left = left;
+				kerns[kern_count].right = right;
+				kerns[kern_count].x = kern;
+				kern_count += 1;
+			}
+		}
+	}
+
+	AtlasHeader header = {0};
+	header.magic = ATLAS_MAGIC;
+	header.version = ATLAS_VERSION;
+	header.size = size;
+	header.height = height;
+	header.ascent = ascent;
+	header.glyph_count = glyph_count;
+	header.kern_count = kern_count;
+	header.width = kAtlasWidth;
+	header.height_px = atlas_height;
+
+	FILE* file = fopen(out_path, "wb");
+	if (!file) {
+		printf("could not write %s\n", out_path);
+		return 1;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(glyphs, sizeof(AtlasGlyph), glyph_count, file);
+	fwrite(kerns, sizeof(AtlasKern), kern_count, file);
+	fwrite(coverage, 1, kAtlasWidth * atlas_height, file);
+	fclose(file);
+
+	printf("%s: %ipx, %i glyphs, %i kerning pairs, %ix%i coverage\n", out_path, size, glyph_count, kern_count, kAtlasWidth, atlas_height);
+
+	free(kerns);
+	free(coverage);
+	FT_Done_Face(face);
+	FT_Done_FreeType(library);
+	return 0;
+}
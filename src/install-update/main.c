@@ -0,0 +1,513 @@
+// install-update
+// streams every file in TrimuiUpdate_MinUI.zip straight to its final path on the card
+// instead of unzipping to .tmp_update and then copying everything again with update.sh
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <zlib.h>
+
+///////////////////////////////////////
+
+// override with -DkSDCard=... to test against a folder on a host
+#ifndef kSDCard
+#define kSDCard "/mnt/SDCARD"
+#endif
+#define kUpdateTmpDir kSDCard "/.tmp_update"
+#define kNotifyPath "/tmp/.update_msg" // read by updateui, same format `notify` writes
+
+#define kBufferSize (64 * 1024)
+static uint8_t in_buffer[kBufferSize];
+static uint8_t out_buffer[kBufferSize];
+
+static int exists(char* path) {
+	return access(path, F_OK)==0;
+}
+
+static void mkdirs(char* path) { // like mkdir -p
+	char tmp[512];
+	snprintf(tmp, sizeof(tmp), "%s", path);
+	for (char* c=tmp+1; *c; c++) {
+		if (*c!='/') continue;
+		*c = '\0';
+		mkdir(tmp, 0755);
+		*c = '/';
+	}
+	mkdir(tmp, 0755);
+}
+
+static int last_percent = -1;
+static char last_message[256];
+static void notify(int percent, char* fmt, ...) {
+	char message[256];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(message, sizeof(message), fmt, args);
+	va_end(args);
+
+	if (percent==last_percent && !strcmp(message, last_message)) return;
+	last_percent = percent;
+	strcpy(last_message, message);
+
+	FILE* file = fopen(kNotifyPath, "w");
+	if (!file) return;
+	fprintf(file, "%d %s\n", percent, message);
+	fclose(file);
+	printf("%3d%% %s\n", percent, message);
+	fflush(stdout);
+}
+
+///////////////////////////////////////
+
+// just enough zip to read what `zip -r` writes: no zip64, no encryption, stored or deflated
+
+#define kEndSignature 0x06054b50
+#define kCentralSignature 0x02014b50
+#define kLocalSignature 0x04034b50
+
+static uint16_t get16(uint8_t* p) {
+	return p[0] | (p[1]<<8);
+}
+static uint32_t get32(uint8_t* p) {
+	return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32_t)p[3]<<24);
+}
+
+typedef struct ZipEntry {
+	char name[256];
+	int method; // 0=stored, 8=deflated
+	uint32_t crc;
+	uint32_t compressed_size;
+	uint32_t size;
+	uint32_t offset; // of the local header
+} ZipEntry;
+
+typedef struct Zip {
+	FILE* file;
+	int count;
+	ZipEntry* entries;
+	uint64_t total_size; // uncompressed, for progress
+} Zip;
+
+static int Zip_open(Zip* self, char* path) {
+	memset(self, 0, sizeof(Zip));
+	self->file = fopen(path, "rb");
+	if (!self->file) return 0;
+
+	// the end of central directory record is followed by an optional comment of up to 64k
+	fseek(self->file, 0, SEEK_END);
+	long size = ftell(self->file);
+	long tail = size<(22+0xffff) ? size : (22+0xffff);
+	uint8_t* buffer = malloc(tail);
+	fseek(self->file, size-tail, SEEK_SET);
+	if (fread(buffer, 1, tail, self->file)!=tail) {
+		free(buffer);
+		return 0;
+	}
+	uint8_t* end = NULL;
+	for (long i=tail-22; i>=0; i--) {
+		if (get32(buffer+i)==kEndSignature) {
+			end = buffer + i;
+			break;
+		}
+	}
+	if (!end) {
+		free(buffer);
+		return 0;
+	}
+	int count = get16(end+10);
+	uint32_t directory_size = get32(end+12);
+	uint32_t directory_offset = get32(end+16);
+	free(buffer);
+
+	uint8_t* directory = malloc(directory_size);
+	fseek(self->file, directory_offset, SEEK_SET);
+	if (fread(directory, 1, directory_size, self->file)!=directory_size) {
+		free(directory);
+		return 0;
+	}
+
+	self->entries = calloc(count, sizeof(ZipEntry));
+	uint8_t* p = directory;
+	for (int i=0; i<count; i++) {
+		if (p+46>directory+directory_size || get32(p)!=kCentralSignature) break;
+
+		ZipEntry* entry = &self->entries[self->count];
+		int flags = get16(p+8);
+		entry->method = get16(p+10);
+		entry->crc = get32(p+16);
+		entry->compressed_size = get32(p+20);
+		entry->size = get32(p+24);
+		int name_length = get16(p+28);
+		int extra_length = get16(p+30);
+		int comment_length = get16(p+32);
+		entry->offset = get32(p+42);
+
+		int length = name_length<sizeof(entry->name) ? name_length : sizeof(entry->name)-1;
+		memcpy(entry->name, p+46, length);
+		entry->name[length] = '\0';
+		p += 46 + name_length + extra_length + comment_length;
+
+		if (flags & 1) continue; // encrypted
+		if (entry->method!=0 && entry->method!=8) continue;
+		self->total_size += entry->size;
+		self->count += 1;
+	}
+	free(directory);
+	return 1;
+}
+static void Zip_close(Zip* self) {
+	if (self->file) fclose(self->file);
+	free(self->entries);
+}
+
+// writes entry to a temporary file next to path then renames it into place,
+// so running binaries, this script's caller and the zip itself can be replaced safely
+static int Zip_extract(Zip* self, ZipEntry* entry, char* path) {
+	uint8_t header[30];
+	fseek(self->file, entry->offset, SEEK_SET);
+	if (fread(header, 1, 30, self->file)!=30 || get32(header)!=kLocalSignature) return 0;
+	fseek(self->file, get16(header+26) + get16(header+28), SEEK_CUR);
+
+	char tmp_path[512];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.install-update", path);
+	int fd = open(tmp_path, O_WRONLY|O_CREAT|O_TRUNC, 0755);
+	if (fd<0) return 0;
+
+	int ok = 1;
+	uint32_t crc = crc32(0L, Z_NULL, 0);
+	uint32_t remaining = entry->compressed_size;
+	if (entry->method==0) {
+		while (remaining && ok) {
+			size_t chunk = remaining<kBufferSize ? remaining : kBufferSize;
+			if (fread(in_buffer, 1, chunk, self->file)!=chunk) ok = 0;
+			else if (write(fd, in_buffer, chunk)!=chunk) ok = 0;
+			crc = crc32(crc, in_buffer, chunk);
+			remaining -= chunk;
+		}
+	}
+	else {
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		if (inflateInit2(&stream, -MAX_WBITS)!=Z_OK) ok = 0; // raw deflate, no zlib header
+		int status = Z_OK;
+		while (ok && status!=Z_STREAM_END) {
+			if (!stream.avail_in) {
+				size_t chunk = remaining<kBufferSize ? remaining : kBufferSize;
+				if (!chunk || fread(in_buffer, 1, chunk, self->file)!=chunk) {
+					ok = 0;
+					break;
+				}
+				remaining -= chunk;
+				stream.next_in = in_buffer;
+				stream.avail_in = chunk;
+			}
+			stream.next_out = out_buffer;
+			stream.avail_out = kBufferSize;
+			status = inflate(&stream, Z_NO_FLUSH);
+			if (status!=Z_OK && status!=Z_STREAM_END) {
+				ok = 0;
+				break;
+			}
+			size_t produced = kBufferSize - stream.avail_out;
+			if (write(fd, out_buffer, produced)!=produced) ok = 0;
+			crc = crc32(crc, out_buffer, produced);
+		}
+		inflateEnd(&stream);
+	}
+	close(fd);
+
+	if (ok && crc!=entry->crc) ok = 0;
+	if (ok && rename(tmp_path, path)!=0) ok = 0;
+	if (!ok) unlink(tmp_path);
+	return ok;
+}
+
+///////////////////////////////////////
+
+// the update.sh rules for paks: skipped entirely with no-update,
+// post.sh run (then removed) once written, new emus get a Roms folder
+
+typedef struct Pak {
+	char path[256]; // relative to the card, eg. Emus/Game Boy.pak
+	char name[256]; // eg. Game Boy
+	int skip;
+	int install;
+} Pak;
+
+#define kMaxPaks 256
+static Pak paks[kMaxPaks];
+static int pak_count = 0;
+
+static Pak* Pak_get(char* entry_name) { // NULL if entry_name isn't inside a pak
+	if (strncmp(entry_name, "Emus/", 5) && strncmp(entry_name, "Games/", 6) && strncmp(entry_name, "Tools/", 6)) return NULL;
+
+	char* slash = strchr(entry_name, '/');
+	char* end = strchr(slash+1, '/');
+	if (!end || end-entry_name<5 || strncmp(end-4, ".pak", 4)) return NULL;
+
+	int length = end - entry_name;
+	for (int i=0; i<pak_count; i++) {
+		if (!strncmp(paks[i].path, entry_name, length) && paks[i].path[length]=='\0') return &paks[i];
+	}
+	if (pak_count==kMaxPaks || length>=sizeof(paks[0].path)) return NULL;
+
+	Pak* self = &paks[pak_count++];
+	memcpy(self->path, entry_name, length);
+	self->path[length] = '\0';
+	int name_length = end - 4 - (slash+1);
+	memcpy(self->name, slash+1, name_length);
+	self->name[name_length] = '\0';
+
+	char path[512];
+	sprintf(path, kSDCard "/%s/no-update", self->path);
+	self->skip = exists(path);
+	sprintf(path, kSDCard "/%s", self->path);
+	self->install = !exists(path);
+	return self;
+}
+
+static void Pak_finish(Pak* self) {
+	if (self->skip) return;
+	char* action = self->install ? "install" : "update";
+
+	char path[512];
+	sprintf(path, kSDCard "/%s/post.sh", self->path);
+	if (exists(path)) {
+		notify(100, "post-%s %s", action, self->name);
+		char cmd[600];
+		sprintf(cmd, "\"%s\"", path);
+		system(cmd);
+		unlink(path);
+	}
+
+	if (self->install && !strncmp(self->path, "Emus/", 5)) {
+		sprintf(path, kSDCard "/Roms/%s", self->name);
+		if (!exists(path)) {
+			notify(100, "add Roms/%s", self->name);
+			mkdirs(path);
+		}
+	}
+}
+
+///////////////////////////////////////
+
+// per-file content hashes generated by the release makefile, one "sha1 size path" line per file
+// the card keeps the manifest of what was last installed so unchanged files can be skipped
+
+#define kManifestName "System/manifest.txt"
+#define kManifestPath kSDCard "/" kManifestName
+#define kManifestTmpPath "/tmp/install-update-manifest.txt"
+
+typedef struct ManifestEntry {
+	char hash[41];
+	long size;
+	char path[256];
+	int installed; // written or already up to date on the card
+} ManifestEntry;
+
+typedef struct Manifest {
+	int count;
+	ManifestEntry* entries; // sorted by path
+} Manifest;
+
+static int ManifestEntry_sort(const void* a, const void* b) {
+	return strcmp(((ManifestEntry*)a)->path, ((ManifestEntry*)b)->path);
+}
+
+static void Manifest_load(Manifest* self, char* path) {
+	memset(self, 0, sizeof(Manifest));
+	FILE* file = fopen(path, "r");
+	if (!file) return;
+
+	int capacity = 1024;
+	self->entries = malloc(sizeof(ManifestEntry) * capacity);
+	char line[512];
+	while (fgets(line, sizeof(line), file)) {
+		if (self->count==capacity) {
+			capacity *= 2;
+			self->entries = realloc(self->entries, sizeof(ManifestEntry) * capacity);
+		}
+		ManifestEntry* entry = &self->entries[self->count];
+		memset(entry, 0, sizeof(ManifestEntry));
+		if (sscanf(line, "%40s %ld %255[^\n]", entry->hash, &entry->size, entry->path)!=3) continue;
+		self->count += 1;
+	}
+	fclose(file);
+	qsort(self->entries, self->count, sizeof(ManifestEntry), ManifestEntry_sort);
+}
+static ManifestEntry* Manifest_find(Manifest* self, char* path) {
+	if (!self->count) return NULL;
+	ManifestEntry key;
+	snprintf(key.path, sizeof(key.path), "%s", path);
+	return bsearch(&key, self->entries, self->count, sizeof(ManifestEntry), ManifestEntry_sort);
+}
+// only what was actually installed, anything left out is written in full next time
+static void Manifest_save(Manifest* self, char* path) {
+	char tmp_path[512];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.install-update", path);
+	FILE* file = fopen(tmp_path, "w");
+	if (!file) return;
+	for (int i=0; i<self->count; i++) {
+		ManifestEntry* entry = &self->entries[i];
+		if (entry->installed) fprintf(file, "%s %ld %s\n", entry->hash, entry->size, entry->path);
+	}
+	fclose(file);
+	rename(tmp_path, path);
+}
+static void Manifest_free(Manifest* self) {
+	free(self->entries);
+}
+
+// unchanged since the last install and still the size it was installed at
+static int isUpToDate(ManifestEntry* next, Manifest* installed, char* path) {
+	if (!next) return 0;
+	ManifestEntry* last = Manifest_find(installed, next->path);
+	if (!last || strcmp(last->hash, next->hash) || last->size!=next->size) return 0;
+
+	struct stat st;
+	if (stat(path, &st)!=0 || st.st_size!=next->size) return 0;
+	return 1;
+}
+
+///////////////////////////////////////
+
+// where an entry goes, NULL to skip it
+static char* getDestination(char* name, char* path) {
+	if (name[0]=='/' || strstr(name, "..")) return NULL;
+
+	// the installer script is what this replaces
+	if (!strcmp(name, "updater")) return NULL;
+	// becomes the persistent .tmp_update/updater that boots MinUI
+	if (!strcmp(name, "launch.sh")) {
+		strcpy(path, kUpdateTmpDir "/updater");
+		return path;
+	}
+	// NOTE: this includes the tiny launcher zip, it replaces the update zip which stays readable until we close it
+	sprintf(path, kSDCard "/%s", name);
+	return path;
+}
+
+// same clean up the installer script does after copying System
+static void cleanUp(void) {
+	if (exists(kSDCard "/System.pak")) { // moved to System/
+		system("rm -rf \"" kSDCard "/System.pak\"");
+		system("rm -rf \"" kSDCard "/Update.pak\"");
+	}
+	if (exists(kSDCard "/recent.txt")) {
+		mkdirs(kSDCard "/.minui");
+		rename(kSDCard "/recent.txt", kSDCard "/.minui/recent.txt");
+	}
+	if (exists(kSDCard "/.logs")) { // moved to .minui/logs/
+		system("rm -rf \"" kSDCard "/.logs\"");
+	}
+	if (exists(kSDCard "/Tools/USB Bridge.pak")) { // now a folder with separate Start and Stop USB Bridge paks
+		system("rm -rf \"" kSDCard "/Tools/USB Bridge.pak\"");
+	}
+}
+
+int main(int argc, char* argv[]) {
+	char* zip_path = argc>1 ? argv[1] : kSDCard "/TrimuiUpdate_MinUI.zip";
+
+	Zip zip;
+	if (!Zip_open(&zip, zip_path)) {
+		notify(0, "unable to read update");
+		Zip_close(&zip);
+		return 1;
+	}
+
+	char* action = exists(kSDCard "/System/System.pak") ? "update" : "install";
+	notify(0, "%s MinUI", action);
+
+	// read the new manifest first so unchanged files are never inflated
+	Manifest installed;
+	Manifest next;
+	Manifest_load(&installed, kManifestPath);
+	memset(&next, 0, sizeof(Manifest));
+	for (int i=0; i<zip.count; i++) {
+		ZipEntry* entry = &zip.entries[i];
+		if (strcmp(entry->name, kManifestName)) continue;
+		if (Zip_extract(&zip, entry, kManifestTmpPath)) {
+			Manifest_load(&next, kManifestTmpPath);
+			unlink(kManifestTmpPath);
+		}
+		break;
+	}
+
+	int failed = 0;
+	int written = 0;
+	int unchanged = 0;
+	uint64_t done = 0;
+	for (int i=0; i<zip.count; i++) {
+		ZipEntry* entry = &zip.entries[i];
+		int percent = zip.total_size ? done * 100 / zip.total_size : 0;
+		done += entry->size;
+
+		if (!strcmp(entry->name, kManifestName)) continue; // written last, see Manifest_save()
+
+		char path[512];
+		if (!getDestination(entry->name, path)) continue;
+
+		Pak* pak = Pak_get(entry->name);
+		if (pak && pak->skip) continue;
+
+		int length = strlen(path);
+		if (path[length-1]=='/') { // directory
+			path[length-1] = '\0';
+			mkdirs(path);
+			continue;
+		}
+
+		// only System and paks are diffed, the installer's own files always have somewhere new to go
+		ManifestEntry* manifest_entry = NULL;
+		if (pak || !strncmp(entry->name, "System/", 7)) manifest_entry = Manifest_find(&next, entry->name);
+		if (isUpToDate(manifest_entry, &installed, path)) {
+			manifest_entry->installed = 1;
+			unchanged += 1;
+			continue;
+		}
+
+		if (pak) notify(percent, "%s %s", pak->install ? "install" : "update", pak->name);
+		else notify(percent, "%s %s", action, strrchr(path, '/')+1);
+
+		char* slash = strrchr(path, '/');
+		*slash = '\0';
+		mkdirs(path);
+		*slash = '/';
+
+		if (!Zip_extract(&zip, entry, path)) {
+			printf("failed to extract %s\n", entry->name);
+			failed += 1;
+		}
+		else {
+			if (manifest_entry) manifest_entry->installed = 1;
+			written += 1;
+		}
+	}
+	Zip_close(&zip);
+	printf("%i files written, %i unchanged\n", written, unchanged);
+	
+	if (next.count) Manifest_save(&next, kManifestPath);
+	Manifest_free(&installed);
+	Manifest_free(&next);
+
+	for (int i=0; i<pak_count; i++) {
+		Pak_finish(&paks[i]);
+	}
+	cleanUp();
+
+	notify(100, "syncing");
+	sync();
+
+	if (failed) notify(100, "%i files failed", failed);
+	else notify(100, "MinUI %s done", action);
+	sleep(1);
+	return failed ? 1 : 0;
+}
@@ -8,10 +8,14 @@
 #include <signal.h>
 #include <linux/input.h>
 #include <sys/mman.h>
+#include <sys/ioctl.h>
 
 #include <msettings.h>
 #include <pthread.h>
 
+#include "keyshm.h"
+#include "powerstats.h"
+
 //	Button Defines
 #define	BUTTON_MENU	KEY_ESC
 #define	BUTTON_SELECT	KEY_RIGHTCTRL
@@ -50,16 +54,21 @@ int	input_fd = 0;
 int	memdev = 0;
 uint32_t		*mem;
 pthread_t		usb_pt;
+KeyShm			*keyshm;
+pthread_mutex_t	keyshm_lock = PTHREAD_MUTEX_INITIALIZER; // checkUSB writes too, the seqlock allows one writer
+PowerStats		power;
 //
 //	Quit
 //
 void quit(int exitcode) {
 	pthread_cancel(usb_pt);
 	pthread_join(usb_pt, NULL);
+	PowerStats_quit(&power);
 	QuitSettings();
 	
 	if (input_fd > 0) close(input_fd);
 	if (memdev > 0) close(memdev);
+	unlink(KEYMON_PID_PATH);
 	exit(exitcode);
 }
 
@@ -107,8 +116,97 @@ inline void openInputDevice(void) {
 	ERROR("Failed to open /dev/input/event");
 }
 
+//
+//	Shared Memory
+//
+int getButtonIndex(uint32_t code) {
+	switch (code) {
+	case KEY_UP:		return KEYSHM_UP;
+	case KEY_DOWN:		return KEYSHM_DOWN;
+	case KEY_LEFT:		return KEYSHM_LEFT;
+	case KEY_RIGHT:		return KEYSHM_RIGHT;
+	case KEY_SPACE:		return KEYSHM_A;
+	case KEY_LEFTCTRL:	return KEYSHM_B;
+	case KEY_LEFTSHIFT:	return KEYSHM_X;
+	case KEY_LEFTALT:	return KEYSHM_Y;
+	case BUTTON_START:	return KEYSHM_START;
+	case BUTTON_SELECT:	return KEYSHM_SELECT;
+	case BUTTON_L:		return KEYSHM_L;
+	case BUTTON_R:		return KEYSHM_R;
+	case BUTTON_MENU:	return KEYSHM_MENU;
+	default:			return -1;
+	}
+}
+
+void openKeyShm(void) {
+	keyshm = KeyShm_create();
+	if (!keyshm) return; // clients fall back to SDL events and libmsettings
+	
+	// prefer monotonic event timestamps so clients can compare against their own clock
+#ifdef EVIOCSCLOCKID
+	int clock = CLOCK_MONOTONIC;
+	if (ioctl(input_fd, EVIOCSCLOCKID, &clock)==0) keyshm->clock = CLOCK_MONOTONIC;
+#endif
+}
+
+void publishButton(uint32_t code, uint32_t val) {
+	if (!keyshm) return;
+	int i = getButtonIndex(code);
+	if (i<0) return;
+	
+	int64_t us = (int64_t)ev.time.tv_sec * 1000000 + ev.time.tv_usec;
+	pthread_mutex_lock(&keyshm_lock);
+	KeyShm_beginWrite(keyshm);
+	if (val==PRESSED) {
+		keyshm->pressed |= 1<<i;
+		keyshm->pressed_at[i] = us;
+	}
+	else {
+		keyshm->pressed &= ~(1<<i);
+		keyshm->released_at[i] = us;
+	}
+	keyshm->events += 1;
+	KeyShm_endWrite(keyshm);
+	pthread_mutex_unlock(&keyshm_lock);
+}
+
+void publishSettings(void) {
+	if (!keyshm) return;
+	pthread_mutex_lock(&keyshm_lock);
+	KeyShm_beginWrite(keyshm);
+	keyshm->volume = GetVolume();
+	keyshm->brightness = GetBrightness();
+	KeyShm_endWrite(keyshm);
+	pthread_mutex_unlock(&keyshm_lock);
+}
+//	libmmenu (or anything else linking libmsettings) can change these without a keymon combo
+void syncSettings(void) {
+	if (!keyshm) return;
+	if (keyshm->volume!=GetVolume() || keyshm->brightness!=GetBrightness()) publishSettings();
+}
+
 #define HasUSBAudio() access("/dev/dsp1", F_OK)==0
 
+//
+//	Power Stats, piggybacks on checkUSB's wakeup instead of adding one
+//
+void updatePower(void) {
+	static int64_t last_tick = 0;
+	if (!power.enabled) return;
+	
+	// a tick this late means fauxSleep() had us stopped, which costs nothing
+	// so move the gap from the current state to sleep without reading /proc
+	int64_t now = KeyShm_now(CLOCK_MONOTONIC);
+	int64_t gap = last_tick ? now - last_tick - 1000000 : 0;
+	if (gap>1000000) {
+		power.totals[POWER_SLEEP].us += gap;
+		power.last.us += gap;
+	}
+	last_tick = now;
+	
+	PowerStats_update(&power, PowerStats_published(power.state));
+}
+
 void* checkUSB(void *arg) {
 	uint32_t has_USB = HasUSBAudio();
 	uint32_t had_USB = has_USB;
@@ -119,6 +217,8 @@ void* checkUSB(void *arg) {
 			had_USB = has_USB;
 			SetVolume(GetVolume());
 		}
+		syncSettings();
+		updatePower();
 	}
 	return 0;
 }
@@ -138,6 +238,16 @@ void main(void) {
 	SetVolume(GetVolume());
 	SetBrightness(GetBrightness());
 	
+	openKeyShm();
+	publishSettings();
+	
+	FILE* pidfile = fopen(KEYMON_PID_PATH, "w");
+	if (pidfile) {
+		fprintf(pidfile, "%d\n", getpid());
+		fclose(pidfile);
+	}
+	
+	PowerStats_init(&power, "keymon", PowerStats_published(POWER_BROWSING));
 	pthread_create(&usb_pt, NULL, &checkUSB, NULL);
 
 	// Main Loop
@@ -152,6 +262,7 @@ void main(void) {
 		if ( val < REPEAT ) {
 			pressedbuttons += val;
 			if (( val == RELEASED )&&( pressedbuttons > 0 )) pressedbuttons--;
+			publishButton(ev.code, val);
 		}
 		switch (ev.code) {
 		case BUTTON_SELECT:
@@ -179,11 +290,13 @@ void main(void) {
 					// SELECT + L : volume down
 					val = GetVolume();
 					if (val>0) SetVolume(--val);
+					publishSettings();
 					break;
 				case START:
 					// START + L : brightness down
 					val = GetBrightness();
 					if (val>0) SetBrightness(--val);
+					publishSettings();
 					break;
 				default:
 					break;
@@ -204,11 +317,13 @@ void main(void) {
 					// SELECT + R : volume up
 					val = GetVolume();
 					if (val<VOLMAX) SetVolume(++val);
+					publishSettings();
 					break;
 				case START:
 					// START + R : brightness up
 					val = GetBrightness();
 					if (val<BRIMAX) SetBrightness(++val);
+					publishSettings();
 					break;
 				default:
 					break;
@@ -0,0 +1,132 @@
+#ifndef KEYSHM_H
+#define KEYSHM_H
+
+//	keyshm.h
+//	lock-free snapshot of button state, volume and brightness published by keymon
+//	keymon is the only writer, any number of clients can map it read-only
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#define KEYSHM_PATH		"/tmp/keyshm" // tmpfs, never touches the SD card
+#define KEYSHM_MAGIC	0x4b53484d // KSHM
+#define KEYSHM_VERSION	1
+
+#define KEYMON_PID_PATH	"/tmp/keymon.pid" // so clients can signal keymon without forking killall
+#define KEYSHM_MAX_AGE	1000000 // microseconds, an older pressed_at belongs to an earlier press
+
+//	button indices, same order as MinUI's kButton* enum
+enum {
+	KEYSHM_UP,
+	KEYSHM_DOWN,
+	KEYSHM_LEFT,
+	KEYSHM_RIGHT,
+	KEYSHM_A,
+	KEYSHM_B,
+	KEYSHM_X,
+	KEYSHM_Y,
+	KEYSHM_START,
+	KEYSHM_SELECT,
+	KEYSHM_L,
+	KEYSHM_R,
+	KEYSHM_MENU,
+	KEYSHM_COUNT,
+};
+
+typedef struct KeyShm {
+	uint32_t magic;
+	uint32_t version;
+	volatile uint32_t seq;	// odd while keymon is writing, bumped twice per update
+	int32_t clock;			// clockid_t the timestamps below are in
+
+	uint32_t pressed;		// bitmask of (1<<KEYSHM_*)
+	uint32_t events;		// total press+release events seen
+	int64_t pressed_at[KEYSHM_COUNT];	// microseconds
+	int64_t released_at[KEYSHM_COUNT];	// microseconds
+
+	int32_t volume;
+	int32_t brightness;
+} KeyShm;
+
+static inline int64_t KeyShm_now(int clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//	writer side (keymon)
+
+static inline void KeyShm_beginWrite(KeyShm* shm) {
+	shm->seq += 1;
+	__sync_synchronize();
+}
+static inline void KeyShm_endWrite(KeyShm* shm) {
+	__sync_synchronize();
+	shm->seq += 1;
+}
+//	a restarted keymon takes over the file its clients already have mapped, it's never unlinked
+static inline KeyShm* KeyShm_create(void) {
+	int fd = open(KEYSHM_PATH, O_RDWR|O_CREAT, 0644);
+	if (fd<0) return NULL;
+	if (ftruncate(fd, sizeof(KeyShm))!=0) {
+		close(fd);
+		return NULL;
+	}
+	KeyShm* shm = mmap(NULL, sizeof(KeyShm), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm==MAP_FAILED) return NULL;
+
+	if (shm->magic==KEYSHM_MAGIC && shm->version==KEYSHM_VERSION) {
+		if (shm->seq & 1) shm->seq += 1; // the last keymon died mid-write
+		KeyShm_beginWrite(shm);
+		shm->pressed = 0; // nothing is held until evdev says so
+		shm->clock = CLOCK_REALTIME;
+		KeyShm_endWrite(shm);
+		return shm;
+	}
+
+	memset(shm, 0, sizeof(KeyShm));
+	shm->version = KEYSHM_VERSION;
+	shm->clock = CLOCK_REALTIME; // evdev default, keymon updates this if it can switch
+	__sync_synchronize();
+	shm->magic = KEYSHM_MAGIC; // published last so clients never see a half-initialized header
+	return shm;
+}
+
+//	reader side (MinUI et al)
+
+static inline const KeyShm* KeyShm_open(void) {
+	int fd = open(KEYSHM_PATH, O_RDONLY);
+	if (fd<0) return NULL;
+	const KeyShm* shm = mmap(NULL, sizeof(KeyShm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm==MAP_FAILED) return NULL;
+	if (shm->magic!=KEYSHM_MAGIC || shm->version!=KEYSHM_VERSION) {
+		munmap((void*)shm, sizeof(KeyShm));
+		return NULL;
+	}
+	return shm;
+}
+static inline void KeyShm_close(const KeyShm* shm) {
+	if (shm) munmap((void*)shm, sizeof(KeyShm));
+}
+//	copies a consistent snapshot into out, retrying while keymon is mid-write
+//	gives up (returns 0) rather than spin on a keymon that was stopped mid-write
+#define KEYSHM_MAX_TRIES 64
+static inline int KeyShm_read(const KeyShm* shm, KeyShm* out) {
+	for (int i=0; i<KEYSHM_MAX_TRIES; i++) {
+		uint32_t seq = shm->seq;
+		if (seq & 1) continue;
+		__sync_synchronize();
+		memcpy(out, (const void*)shm, sizeof(KeyShm));
+		__sync_synchronize();
+		if (seq==shm->seq) return 1;
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef POWERSTATS_H
+#define POWERSTATS_H
+
+//	powerstats.h
+//	wakeups (voluntary context switches), preemptions and CPU time for the whole process,
+//	split by what the device was doing, so idle drain regressions show up as numbers
+//	opt-in with .minui/enable-power, summaries are appended to .minui/logs/power-<name>.txt
+//	MinUI publishes the state to POWER_STATE_PATH on every change, keymon follows it
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "keyshm.h" // KeyShm_now()
+
+#define POWER_ENABLE_PATH	"/mnt/SDCARD/.minui/enable-power"
+#define POWER_LOG_PATH		"/mnt/SDCARD/.minui/logs/power-%s.txt"
+#define POWER_STATE_PATH	"/tmp/power_state" // tmpfs, a single digit
+#define POWER_LOG_INTERVAL	(5 * 60 * 1000000LL) // microseconds between summaries
+
+enum {
+	POWER_BROWSING,	// MinUI is up and being used
+	POWER_IDLE,		// MinUI is up, nothing pressed for a while
+	POWER_SLEEP,	// fauxSleep(), keymon is stopped for all of it
+	POWER_GAME,		// MinUI exited (or is waiting in resident mode) for a pak
+	POWER_STATE_COUNT,
+};
+
+static char* power_state_names[POWER_STATE_COUNT] = {
+	"browsing",
+	"idle",
+	"sleep",
+	"in-game",
+};
+
+typedef struct PowerCounters {
+	int64_t us;			// CLOCK_MONOTONIC
+	int64_t cpu_ticks;	// utime + stime, in sysconf(_SC_CLK_TCK)
+	int64_t voluntary;	// blocked and woke up again
+	int64_t involuntary;	// preempted
+} PowerCounters;
+
+typedef struct PowerStats {
+	char* name;
+	int enabled;
+	int state;
+	int64_t started;
+	int64_t logged;
+	PowerCounters last;
+	PowerCounters totals[POWER_STATE_COUNT];
+} PowerStats;
+
+//	/proc/self/stat has CPU time for every thread, including ones that already exited
+//	/proc/self/status only counts the main thread's context switches, getrusage() counts all of them
+static inline void PowerCounters_read(PowerCounters* self) {
+	memset(self, 0, sizeof(PowerCounters));
+	self->us = KeyShm_now(CLOCK_MONOTONIC);
+
+	char line[512];
+	FILE* file = fopen("/proc/self/stat", "r");
+	if (file) {
+		if (fgets(line, sizeof(line), file)) {
+			char* fields = strrchr(line, ')'); // comm can have spaces
+			unsigned long utime, stime;
+			if (fields && sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime)==2) {
+				self->cpu_ticks = utime + stime;
+			}
+		}
+		fclose(file);
+	}
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage)==0) {
+		self->voluntary = usage.ru_nvcsw;
+		self->involuntary = usage.ru_nivcsw;
+	}
+}
+
+//	charges everything since the last call to the current state
+static inline void PowerStats_charge(PowerStats* self) {
+	PowerCounters now;
+	PowerCounters_read(&now);
+	PowerCounters* total = &self->totals[self->state];
+	total->us += now.us - self->last.us;
+	total->cpu_ticks += now.cpu_ticks - self->last.cpu_ticks;
+	total->voluntary += now.voluntary - self->last.voluntary;
+	total->involuntary += now.involuntary - self->last.involuntary;
+	self->last = now;
+}
+
+static inline void PowerStats_log(PowerStats* self, char* reason) {
+	char path[256];
+	snprintf(path, sizeof(path), POWER_LOG_PATH, self->name);
+	FILE* file = fopen(path, "a");
+	if (!file) return;
+
+	double ticks_per_second = sysconf(_SC_CLK_TCK);
+	fprintf(file, "%s (%s) after %llds, pid %d\n", self->name, reason, (long long)((self->last.us - self->started) / 1000000), getpid());
+	fprintf(file, "  %-10s %10s %10s %10s %8s\n", "state", "seconds", "wakeups/s", "preempt/s", "cpu");
+	for (int i=0; i<POWER_STATE_COUNT; i++) {
+		PowerCounters* total = &self->totals[i];
+		if (!total->us) continue;
+		double seconds = total->us / 1000000.0;
+		fprintf(file, "  %-10s %10.1f %10.2f %10.2f %7.2f%%\n",
+			power_state_names[i],
+			seconds,
+			total->voluntary / seconds,
+			total->involuntary / seconds,
+			total->cpu_ticks / ticks_per_second / seconds * 100
+		);
+	}
+	fclose(file);
+}
+
+static inline void PowerStats_init(PowerStats* self, char* name, int state) {
+	memset(self, 0, sizeof(PowerStats));
+	self->name = name;
+	self->state = state;
+	self->enabled = access(POWER_ENABLE_PATH, F_OK)==0;
+	if (!self->enabled) return;
+	PowerCounters_read(&self->last);
+	self->started = self->logged = self->last.us;
+}
+
+//	cheap enough to call every frame, only touches /proc when the state changes or a summary is due
+static inline void PowerStats_update(PowerStats* self, int state) {
+	if (!self->enabled) return;
+	if (state!=self->state) {
+		PowerStats_charge(self);
+		self->state = state;
+	}
+	if (KeyShm_now(CLOCK_MONOTONIC)-self->logged>=POWER_LOG_INTERVAL) {
+		PowerStats_charge(self);
+		PowerStats_log(self, "periodic");
+		self->logged = self->last.us;
+	}
+}
+
+static inline void PowerStats_quit(PowerStats* self) {
+	if (!self->enabled) return;
+	PowerStats_charge(self);
+	PowerStats_log(self, "exit");
+}
+
+//	MinUI's side of the handoff to keymon
+static inline void PowerStats_publish(PowerStats* self, int state) {
+	if (!self->enabled) return;
+	int fd = open(POWER_STATE_PATH, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if (fd<0) return;
+	char digit = '0' + state;
+	write(fd, &digit, 1);
+	close(fd);
+}
+static inline int PowerStats_published(int fallback) {
+	int fd = open(POWER_STATE_PATH, O_RDONLY);
+	if (fd<0) return fallback;
+	char digit = 0;
+	read(fd, &digit, 1);
+	close(fd);
+	return digit>='0' && digit<'0'+POWER_STATE_COUNT ? digit - '0' : fallback;
+}
+
+#endif
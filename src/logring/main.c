@@ -0,0 +1,246 @@
+// logring
+// collects a program's output in a fixed size ring in tmpfs so a chatty emulator never
+// makes small synchronous writes to the SD card while running, the ring is written to
+// .minui/logs only when the pipe closes (clean exit or crash), on SIGUSR1 or on request
+//
+//   program 2>&1 | logring <name>	collect into /tmp/logs/<name>.ring
+//   logring flush					write every ring to the SD card, removing orphaned ones
+//
+// each session's first flush moves the previous <name>.txt to <name>.1.txt
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <dirent.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+///////////////////////////////////////
+
+// override with -DkSDCard=... to test against a folder on a host
+#ifndef kSDCard
+#define kSDCard "/mnt/SDCARD"
+#endif
+#define kLogsDir kSDCard "/.minui/logs"
+#ifndef kRingDir
+#define kRingDir "/tmp/logs"
+#endif
+
+#define kRingSize (64 * 1024) // bytes kept per source, the newest output wins
+#define kRingMagic 0x474e5252 // RRNG
+
+typedef struct Ring {
+	uint32_t magic;
+	uint32_t size; // of data
+	uint64_t written; // ever, the head is written % size
+	int32_t pid; // of the collector
+	int32_t flushed; // this session already rotated the previous log
+	char data[];
+} Ring;
+
+static void Ring_write(Ring* self, char* bytes, size_t count) {
+	// only the tail of an oversized write survives anyway
+	if (count>self->size) {
+		self->written += count - self->size;
+		bytes += count - self->size;
+		count = self->size;
+	}
+	size_t head = self->written % self->size;
+	size_t first = self->size - head;
+	if (first>count) first = count;
+	memcpy(self->data + head, bytes, first);
+	memcpy(self->data, bytes + first, count - first);
+	self->written += count;
+}
+
+static Ring* Ring_map(int fd) {
+	struct stat st;
+	if (fstat(fd, &st)!=0 || st.st_size<(off_t)sizeof(Ring)) return NULL;
+	Ring* self = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if (self==MAP_FAILED) return NULL;
+	if (self->magic!=kRingMagic || sizeof(Ring)+self->size!=(size_t)st.st_size) {
+		munmap(self, st.st_size);
+		return NULL;
+	}
+	return self;
+}
+
+static void Ring_unmap(Ring* self) {
+	munmap(self, sizeof(Ring) + self->size);
+}
+
+///////////////////////////////////////
+
+static void getLogPath(char* name, int generation, char* path) {
+	if (generation) sprintf(path, "%s/%s.%i.txt", kLogsDir, name, generation);
+	else sprintf(path, "%s/%s.txt", kLogsDir, name);
+}
+
+static int writeAll(int fd, char* bytes, size_t count) {
+	while (count) {
+		ssize_t written = write(fd, bytes, count);
+		if (written<0) {
+			if (errno==EINTR) continue;
+			return 0;
+		}
+		bytes += written;
+		count -= written;
+	}
+	return 1;
+}
+
+// one open, one or two writes and one close no matter how much was logged
+static void Ring_flush(Ring* self, char* name) {
+	char path[256];
+	getLogPath(name, 0, path);
+	if (!self->flushed) {
+		char old_path[256];
+		getLogPath(name, 1, old_path);
+		rename(path, old_path);
+		self->flushed = 1;
+	}
+
+	int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if (fd<0) return;
+
+	uint64_t written = self->written; // a live collector may keep writing, take a snapshot
+	size_t head = written % self->size;
+	if (written>self->size) {
+		char dropped[64];
+		int length = sprintf(dropped, "[logring: %llu earlier bytes dropped]\n", (unsigned long long)(written - self->size));
+		writeAll(fd, dropped, length);
+		writeAll(fd, self->data + head, self->size - head);
+		writeAll(fd, self->data, head);
+	}
+	else writeAll(fd, self->data, written);
+	close(fd);
+}
+
+///////////////////////////////////////
+
+static volatile sig_atomic_t flush_requested = 0;
+static volatile sig_atomic_t quit_requested = 0;
+
+static void onSignal(int sig) {
+	if (sig==SIGUSR1) flush_requested = 1;
+	else quit_requested = 1;
+}
+
+// without tmpfs behave like the `&>` this replaces, stdin still has to be drained
+// or the program would die of SIGPIPE
+static int passthrough(char* name) {
+	char path[256];
+	getLogPath(name, 0, path);
+	int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+
+	char buffer[4096];
+	ssize_t count;
+	while ((count = read(0, buffer, sizeof(buffer)))!=0) {
+		if (count<0) {
+			if (errno==EINTR && !quit_requested) continue;
+			break;
+		}
+		if (fd>=0) writeAll(fd, buffer, count);
+	}
+	if (fd>=0) close(fd);
+	return 0;
+}
+
+static int collect(char* name) {
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onSignal; // no SA_RESTART so read() returns to check the flags
+	sigaction(SIGUSR1, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
+
+	char ring_path[256];
+	mkdir(kRingDir, 0755);
+	sprintf(ring_path, "%s/%s.ring", kRingDir, name);
+	int fd = open(ring_path, O_RDWR|O_CREAT|O_TRUNC, 0644);
+	if (fd<0) return passthrough(name);
+	if (ftruncate(fd, sizeof(Ring) + kRingSize)!=0) {
+		close(fd);
+		unlink(ring_path);
+		return passthrough(name);
+	}
+	Ring* ring = mmap(NULL, sizeof(Ring) + kRingSize, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring==MAP_FAILED) {
+		unlink(ring_path);
+		return passthrough(name);
+	}
+	ring->size = kRingSize;
+	ring->written = 0;
+	ring->pid = getpid();
+	ring->flushed = 0;
+	ring->magic = kRingMagic; // last so `logring flush` never sees a partial header
+
+	// the ring lives in a tmpfs file so a killed collector's output survives for `logring flush`
+	char buffer[4096];
+	while (!quit_requested) {
+		ssize_t count = read(0, buffer, sizeof(buffer));
+		if (count<0) {
+			if (errno!=EINTR) break;
+			if (flush_requested) {
+				flush_requested = 0;
+				Ring_flush(ring, name);
+			}
+			continue;
+		}
+		if (count==0) break;
+		Ring_write(ring, buffer, count);
+	}
+
+	Ring_flush(ring, name);
+	Ring_unmap(ring);
+	unlink(ring_path);
+	return 0;
+}
+
+// writes what's in every ring, live collectors keep going, orphaned rings are removed
+static int flushAll(void) {
+	DIR* dh = opendir(kRingDir);
+	if (!dh) return 0;
+
+	struct dirent* dp;
+	while ((dp = readdir(dh))) {
+		char* ext = strrchr(dp->d_name, '.');
+		if (!ext || strcmp(ext, ".ring")) continue;
+
+		char ring_path[512];
+		snprintf(ring_path, sizeof(ring_path), "%s/%s", kRingDir, dp->d_name);
+		int fd = open(ring_path, O_RDWR);
+		if (fd<0) continue;
+		Ring* ring = Ring_map(fd);
+		close(fd);
+		if (!ring) continue;
+
+		char name[256];
+		snprintf(name, sizeof(name), "%.*s", (int)(ext - dp->d_name), dp->d_name);
+		Ring_flush(ring, name);
+		int orphaned = kill(ring->pid, 0)!=0 && errno==ESRCH;
+		Ring_unmap(ring);
+		if (orphaned) unlink(ring_path);
+	}
+	closedir(dh);
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc<2) {
+		fputs("usage: program 2>&1 | logring <name>\n       logring flush\n", stderr);
+		return 1;
+	}
+	if (!strcmp(argv[1], "flush")) return flushAll();
+	if (strchr(argv[1], '/')) return passthrough("logring"); // names become file names
+	return collect(argv[1]);
+}
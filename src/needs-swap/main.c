@@ -0,0 +1,189 @@
+// needs-swap
+// makes sure the swapfile exists then only turns it on when memory actually runs low:
+// right away if the rom obviously won't fit, otherwise from a monitor that samples
+// /proc/meminfo until the launching pak exits and then logs how much swap was used
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/swap.h>
+
+///////////////////////////////////////
+
+// override with -DkSDCard=... to test against a folder on a host
+#ifndef kSDCard
+#define kSDCard "/mnt/SDCARD"
+#endif
+#define kSwapPath kSDCard "/.minui/swapfile"
+#define kSwapLogPath kSDCard "/.minui/logs/swap.txt"
+#define kUsingSwapPath "/tmp/using-swap" // System.pak/launch.sh runs swapoff when this exists
+
+#define kSwapSize (128 * 1024 * 1024)
+#define kSwapThreshold (6 * 1024) // KB of available memory below which swap is turned on
+#define kPressureInterval 100 // ms between samples until swap is on
+#define kUsageInterval 1000 // ms between samples after
+
+static void sleepMs(int ms) {
+	struct timespec ts = { ms / 1000, (ms % 1000) * 1000000 };
+	nanosleep(&ts, NULL);
+}
+
+///////////////////////////////////////
+
+typedef struct MemInfo {
+	long available; // KB, free plus reclaimable page cache (older kernels don't have MemAvailable)
+	long swap_total;
+	long swap_used;
+} MemInfo;
+
+static void MemInfo_read(MemInfo* self) {
+	memset(self, 0, sizeof(MemInfo));
+	FILE* file = fopen("/proc/meminfo", "r");
+	if (!file) return;
+
+	long mem_available = -1;
+	long mem_free = 0;
+	long buffers = 0;
+	long cached = 0;
+	long swap_free = 0;
+	char line[128];
+	while (fgets(line, sizeof(line), file)) {
+		char key[64];
+		long value;
+		if (sscanf(line, "%63[^:]: %ld", key, &value)!=2) continue;
+		if (!strcmp(key, "MemAvailable")) mem_available = value;
+		else if (!strcmp(key, "MemFree")) mem_free = value;
+		else if (!strcmp(key, "Buffers")) buffers = value;
+		else if (!strcmp(key, "Cached")) cached = value;
+		else if (!strcmp(key, "SwapTotal")) self->swap_total = value;
+		else if (!strcmp(key, "SwapFree")) swap_free = value;
+	}
+	fclose(file);
+
+	self->available = mem_available>=0 ? mem_available : mem_free + buffers + cached;
+	self->swap_used = self->swap_total - swap_free;
+}
+
+///////////////////////////////////////
+
+// swap can't have holes so the whole file has to be allocated, fallocate() does that
+// without writing anything where the filesystem supports it (vfat only on newer kernels)
+static int allocate(int fd) {
+	if (fallocate(fd, 0, 0, kSwapSize)==0) return 1;
+
+	// otherwise write zeros in large chunks, still avoids dd's read of /dev/zero per block
+	#define kChunkSize (1024 * 1024)
+	char* zeros = calloc(1, kChunkSize);
+	if (!zeros) return 0;
+	int ok = 1;
+	for (int written=0; written<kSwapSize && ok; written+=kChunkSize) {
+		if (write(fd, zeros, kChunkSize)!=kChunkSize) ok = 0;
+	}
+	free(zeros);
+	return ok;
+}
+
+static int provision(void) {
+	struct stat st;
+	if (stat(kSwapPath, &st)==0 && st.st_size==kSwapSize) return 1;
+
+	system("show " kSDCard "/System/res/swap.png");
+
+	int fd = open(kSwapPath, O_WRONLY|O_CREAT|O_TRUNC, 0600);
+	if (fd<0) return 0;
+	int ok = allocate(fd);
+	fsync(fd);
+	close(fd);
+	if (!ok) {
+		unlink(kSwapPath);
+		return 0;
+	}
+	return system("mkswap " kSwapPath " > /dev/null")==0;
+}
+
+static int enableSwap(void) {
+	if (swapon(kSwapPath, 0)!=0) return 0;
+	close(open(kUsingSwapPath, O_RDWR|O_CREAT, 0644)); // basically touch
+	return 1;
+}
+
+///////////////////////////////////////
+
+static void logSession(char* rom_path, long rom_size, int enabled, int predicted, MemInfo* low, long peak_swap) {
+	FILE* file = fopen(kSwapLogPath, "a");
+	if (!file) return;
+	char* rom_name = strrchr(rom_path, '/');
+	fprintf(file, "%s: rom %ldKB, min available %ldKB, swap %s, peak swap used %ldKB\n",
+		rom_name ? rom_name+1 : rom_path,
+		rom_size / 1024,
+		low->available,
+		enabled ? (predicted ? "on at launch" : "on under pressure") : "off",
+		peak_swap
+	);
+	fclose(file);
+}
+
+// runs detached until the pak that launched us exits
+static void monitor(pid_t pak, char* rom_path, long rom_size, int enabled) {
+	int predicted = enabled;
+	MemInfo low;
+	MemInfo_read(&low);
+	long peak_swap = 0;
+
+	while (kill(pak, 0)==0) {
+		sleepMs(enabled ? kUsageInterval : kPressureInterval);
+
+		MemInfo info;
+		MemInfo_read(&info);
+		if (info.available<low.available) low.available = info.available;
+		if (info.swap_used>peak_swap) peak_swap = info.swap_used;
+
+		if (!enabled && info.available<kSwapThreshold) enabled = enableSwap();
+	}
+
+	logSession(rom_path, rom_size, enabled, predicted, &low, peak_swap);
+}
+
+int main(int argc, char* argv[]) {
+	char* rom_path = argc>1 ? argv[1] : "";
+
+	if (!provision()) return 1;
+
+	// the emulator holds roughly the whole rom in memory
+	struct stat st;
+	long rom_size = stat(rom_path, &st)==0 ? st.st_size : 0;
+	MemInfo info;
+	MemInfo_read(&info);
+	int enabled = 0;
+	if (info.available - rom_size / 1024 < kSwapThreshold) enabled = enableSwap();
+
+	pid_t pak = getppid();
+	pid_t pid = fork();
+	if (pid<0) {
+		// can't monitor so err on the side of not getting killed
+		if (!enabled) enableSwap();
+		return 0;
+	}
+	if (pid>0) return 0; // let the pak carry on launching
+
+	setsid();
+	signal(SIGHUP, SIG_IGN);
+	int null = open("/dev/null", O_RDWR);
+	if (null>=0) {
+		dup2(null, 0);
+		dup2(null, 1);
+		dup2(null, 2);
+		close(null);
+	}
+	monitor(pak, rom_path, rom_size, enabled);
+	return 0;
+}
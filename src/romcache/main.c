@@ -0,0 +1,444 @@
+// romcache
+// extracts a zipped rom into .minui/romcache and prints the path the pak should launch instead
+// extracted roms are kept, least recently launched evicted first, so relaunching one is instant
+// anything it can't (or shouldn't) extract is printed back unchanged for the emulator to handle
+// only .zip is extracted, there's no 7z decoder on the device so .7z roms go straight to the emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <utime.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#include <zlib.h>
+
+#include "../timeline/timeline.h"
+
+///////////////////////////////////////
+
+// override with -DkSDCard=... to test against a folder on a host
+#ifndef kSDCard
+#define kSDCard "/mnt/SDCARD"
+#endif
+#define kRomsDir kSDCard "/Roms/"
+#define kCacheDir kSDCard "/.minui/romcache"
+#define kSourceName ".source" // size and mtime of the archive an entry came from, written last
+
+#define kCacheSize (512LL * 1024 * 1024) // all entries together
+#define kFreeMargin (64LL * 1024 * 1024) // always left free on the card
+
+#define kBufferSize (64 * 1024)
+static uint8_t in_buffer[kBufferSize];
+static uint8_t out_buffer[kBufferSize];
+
+static int exists(char* path) {
+	return access(path, F_OK)==0;
+}
+
+static void mkdirs(char* path) { // like mkdir -p
+	char tmp[512];
+	snprintf(tmp, sizeof(tmp), "%s", path);
+	for (char* c=tmp+1; *c; c++) {
+		if (*c!='/') continue;
+		*c = '\0';
+		mkdir(tmp, 0755);
+		*c = '/';
+	}
+	mkdir(tmp, 0755);
+}
+
+static int hasSuffix(char* suffix, char* str) {
+	int len = strlen(suffix);
+	int str_len = strlen(str);
+	return str_len>=len && !strcasecmp(suffix, str+str_len-len);
+}
+
+///////////////////////////////////////
+
+// just enough zip to read what `zip` and most rom sets write: no zip64, no encryption, stored or deflated
+
+#define kEndSignature 0x06054b50
+#define kCentralSignature 0x02014b50
+#define kLocalSignature 0x04034b50
+
+static uint16_t get16(uint8_t* p) {
+	return p[0] | (p[1]<<8);
+}
+static uint32_t get32(uint8_t* p) {
+	return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32_t)p[3]<<24);
+}
+
+typedef struct ZipEntry {
+	char name[256];
+	int method; // 0=stored, 8=deflated
+	uint32_t crc;
+	uint32_t compressed_size;
+	uint32_t size;
+	uint32_t offset; // of the local header
+} ZipEntry;
+
+typedef struct Zip {
+	FILE* file;
+	int count;
+	ZipEntry* entries;
+	int64_t total_size; // uncompressed
+} Zip;
+
+static int Zip_open(Zip* self, char* path) {
+	memset(self, 0, sizeof(Zip));
+	self->file = fopen(path, "rb");
+	if (!self->file) return 0;
+
+	// the end of central directory record is followed by an optional comment of up to 64k
+	fseek(self->file, 0, SEEK_END);
+	long size = ftell(self->file);
+	long tail = size<(22+0xffff) ? size : (22+0xffff);
+	uint8_t* buffer = malloc(tail);
+	fseek(self->file, size-tail, SEEK_SET);
+	if (fread(buffer, 1, tail, self->file)!=tail) {
+		free(buffer);
+		return 0;
+	}
+	uint8_t* end = NULL;
+	for (long i=tail-22; i>=0; i--) {
+		if (get32(buffer+i)==kEndSignature) {
+			end = buffer + i;
+			break;
+		}
+	}
+	if (!end) {
+		free(buffer);
+		return 0;
+	}
+	int count = get16(end+10);
+	uint32_t directory_size = get32(end+12);
+	uint32_t directory_offset = get32(end+16);
+	free(buffer);
+
+	uint8_t* directory = malloc(directory_size);
+	fseek(self->file, directory_offset, SEEK_SET);
+	if (fread(directory, 1, directory_size, self->file)!=directory_size) {
+		free(directory);
+		return 0;
+	}
+
+	self->entries = calloc(count, sizeof(ZipEntry));
+	uint8_t* p = directory;
+	for (int i=0; i<count; i++) {
+		if (p+46>directory+directory_size || get32(p)!=kCentralSignature) break;
+
+		ZipEntry* entry = &self->entries[self->count];
+		int flags = get16(p+8);
+		entry->method = get16(p+10);
+		entry->crc = get32(p+16);
+		entry->compressed_size = get32(p+20);
+		entry->size = get32(p+24);
+		int name_length = get16(p+28);
+		int extra_length = get16(p+30);
+		int comment_length = get16(p+32);
+		entry->offset = get32(p+42);
+
+		int length = name_length<sizeof(entry->name) ? name_length : sizeof(entry->name)-1;
+		memcpy(entry->name, p+46, length);
+		entry->name[length] = '\0';
+		p += 46 + name_length + extra_length + comment_length;
+
+		if (flags & 1) continue; // encrypted
+		if (entry->method!=0 && entry->method!=8) continue;
+		if (entry->name[length-1]=='/') continue; // directory
+		if (!strncmp(entry->name, "__MACOSX/", 9)) continue;
+		char* name = strrchr(entry->name, '/');
+		if ((name ? name+1 : entry->name)[0]=='.') continue;
+
+		self->total_size += entry->size;
+		self->count += 1;
+	}
+	free(directory);
+	return 1;
+}
+static void Zip_close(Zip* self) {
+	if (self->file) fclose(self->file);
+	free(self->entries);
+}
+
+static int Zip_extract(Zip* self, ZipEntry* entry, char* path) {
+	uint8_t header[30];
+	fseek(self->file, entry->offset, SEEK_SET);
+	if (fread(header, 1, 30, self->file)!=30 || get32(header)!=kLocalSignature) return 0;
+	fseek(self->file, get16(header+26) + get16(header+28), SEEK_CUR);
+
+	int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if (fd<0) return 0;
+
+	int ok = 1;
+	uint32_t crc = crc32(0L, Z_NULL, 0);
+	uint32_t remaining = entry->compressed_size;
+	if (entry->method==0) {
+		while (remaining && ok) {
+			size_t chunk = remaining<kBufferSize ? remaining : kBufferSize;
+			if (fread(in_buffer, 1, chunk, self->file)!=chunk) ok = 0;
+			else if (write(fd, in_buffer, chunk)!=chunk) ok = 0;
+			crc = crc32(crc, in_buffer, chunk);
+			remaining -= chunk;
+		}
+	}
+	else {
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		if (inflateInit2(&stream, -MAX_WBITS)!=Z_OK) ok = 0; // raw deflate, no zlib header
+		int status = Z_OK;
+		while (ok && status!=Z_STREAM_END) {
+			if (!stream.avail_in) {
+				size_t chunk = remaining<kBufferSize ? remaining : kBufferSize;
+				if (!chunk || fread(in_buffer, 1, chunk, self->file)!=chunk) {
+					ok = 0;
+					break;
+				}
+				remaining -= chunk;
+				stream.next_in = in_buffer;
+				stream.avail_in = chunk;
+			}
+			stream.next_out = out_buffer;
+			stream.avail_out = kBufferSize;
+			status = inflate(&stream, Z_NO_FLUSH);
+			if (status!=Z_OK && status!=Z_STREAM_END) {
+				ok = 0;
+				break;
+			}
+			size_t produced = kBufferSize - stream.avail_out;
+			if (write(fd, out_buffer, produced)!=produced) ok = 0;
+			crc = crc32(crc, out_buffer, produced);
+		}
+		inflateEnd(&stream);
+	}
+	close(fd);
+
+	return ok && crc==entry->crc;
+}
+
+///////////////////////////////////////
+
+// each archive gets a folder, kCacheDir/<emu>/<archive name>, its mtime is when it was last launched
+
+static void removeEntry(char* dir_path) {
+	DIR* dh = opendir(dir_path);
+	if (dh) {
+		struct dirent* dp;
+		while ((dp = readdir(dh))) {
+			if (!strcmp(dp->d_name, ".") || !strcmp(dp->d_name, "..")) continue;
+			char path[512];
+			snprintf(path, sizeof(path), "%s/%s", dir_path, dp->d_name);
+			unlink(path);
+		}
+		closedir(dh);
+	}
+	rmdir(dir_path);
+}
+
+static int64_t getEntrySize(char* dir_path) {
+	int64_t size = 0;
+	DIR* dh = opendir(dir_path);
+	if (!dh) return 0;
+	struct dirent* dp;
+	while ((dp = readdir(dh))) {
+		char path[768];
+		if (snprintf(path, sizeof(path), "%s/%s", dir_path, dp->d_name)>=sizeof(path)) continue;
+		struct stat st;
+		if (stat(path, &st)==0 && S_ISREG(st.st_mode)) size += st.st_size;
+	}
+	closedir(dh);
+	return size;
+}
+
+typedef struct CacheEntry {
+	char path[768]; // a 512 byte emu folder, a slash and a 255 byte name
+	time_t used;
+	int64_t size;
+} CacheEntry;
+
+static int CacheEntry_sort(const void* a, const void* b) { // least recently used first
+	time_t ua = ((CacheEntry*)a)->used;
+	time_t ub = ((CacheEntry*)b)->used;
+	return (ua>ub) - (ua<ub);
+}
+
+static int64_t getFreeSpace(void) {
+	struct statvfs st;
+	if (statvfs(kCacheDir, &st)!=0) return 0;
+	return (int64_t)st.f_bavail * st.f_frsize;
+}
+
+// evicts until needed bytes fit under kCacheSize and kFreeMargin, returns 0 if they never will
+static int makeRoom(int64_t needed) {
+	if (needed>kCacheSize) return 0;
+
+	int count = 0;
+	int capacity = 64;
+	CacheEntry* entries = malloc(capacity * sizeof(CacheEntry));
+	int64_t total = 0;
+
+	DIR* emus = opendir(kCacheDir);
+	struct dirent* emu;
+	while (emus && (emu = readdir(emus))) {
+		if (emu->d_name[0]=='.') continue;
+		char emu_path[512];
+		snprintf(emu_path, sizeof(emu_path), "%s/%s", kCacheDir, emu->d_name);
+		DIR* dh = opendir(emu_path);
+		struct dirent* dp;
+		while (dh && (dp = readdir(dh))) {
+			if (dp->d_name[0]=='.') continue;
+			if (count==capacity) {
+				capacity *= 2;
+				entries = realloc(entries, capacity * sizeof(CacheEntry));
+			}
+			CacheEntry* entry = &entries[count];
+			snprintf(entry->path, sizeof(entry->path), "%s/%s", emu_path, dp->d_name);
+			struct stat st;
+			if (stat(entry->path, &st)!=0 || !S_ISDIR(st.st_mode)) continue;
+			entry->used = st.st_mtime;
+			entry->size = getEntrySize(entry->path);
+			total += entry->size;
+			count += 1;
+		}
+		if (dh) closedir(dh);
+	}
+	if (emus) closedir(emus);
+
+	qsort(entries, count, sizeof(CacheEntry), CacheEntry_sort);
+	int64_t free_space = getFreeSpace();
+	for (int i=0; i<count && (total+needed>kCacheSize || free_space-needed<kFreeMargin); i++) {
+		removeEntry(entries[i].path);
+		total -= entries[i].size;
+		free_space += entries[i].size;
+	}
+	free(entries);
+	return total+needed<=kCacheSize && free_space-needed>=kFreeMargin;
+}
+
+static int readSource(char* source_path, struct stat* archive, char* launch_name) {
+	FILE* file = fopen(source_path, "r");
+	if (!file) return 0;
+	long long size = 0;
+	long long mtime = 0;
+	int ok = fscanf(file, "%lld %lld\n", &size, &mtime)==2 && fgets(launch_name, 256, file);
+	fclose(file);
+	if (!ok) return 0;
+	launch_name[strcspn(launch_name, "\n")] = '\0';
+	return size==archive->st_size && mtime==archive->st_mtime;
+}
+
+static void writeSource(char* source_path, struct stat* archive, char* launch_name) {
+	FILE* file = fopen(source_path, "w");
+	if (!file) return;
+	fprintf(file, "%lld %lld\n%s\n", (long long)archive->st_size, (long long)archive->st_mtime, launch_name);
+	fclose(file);
+}
+
+///////////////////////////////////////
+
+// extracts every file flat into entry_path and picks the one to launch:
+// a lone rom is renamed after the archive so saves and resume slots keep their names,
+// a multi-file set launches its cue (or m3u) otherwise its largest file
+static int extract(Zip* zip, char* entry_path, char* base_name, char* launch_name) {
+	mkdirs(entry_path);
+
+	int largest = 0;
+	int playlist = -1;
+	for (int i=0; i<zip->count; i++) {
+		ZipEntry* entry = &zip->entries[i];
+		if (entry->size>zip->entries[largest].size) largest = i;
+		if (hasSuffix(".cue", entry->name) || (playlist<0 && hasSuffix(".m3u", entry->name))) playlist = i;
+	}
+
+	for (int i=0; i<zip->count; i++) {
+		ZipEntry* entry = &zip->entries[i];
+		char* name = strrchr(entry->name, '/');
+		name = name ? name+1 : entry->name;
+
+		char file_name[256];
+		if (zip->count==1) {
+			char* extension = strrchr(name, '.');
+			snprintf(file_name, sizeof(file_name), "%s%s", base_name, extension ? extension : "");
+		}
+		else strcpy(file_name, name);
+
+		char path[768];
+		snprintf(path, sizeof(path), "%s/%s", entry_path, file_name);
+		if (!Zip_extract(zip, entry, path)) return 0;
+
+		if (i==(playlist>=0 ? playlist : largest)) strcpy(launch_name, file_name);
+	}
+	return 1;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc<2) {
+		puts("Usage: romcache <rom>");
+		return 1;
+	}
+	char* rom_path = argv[1];
+
+	struct stat archive;
+	if (!hasSuffix(".zip", rom_path) || stat(rom_path, &archive)!=0) {
+		puts(rom_path);
+		return 0;
+	}
+
+	char emu_name[256];
+	if (!strncmp(rom_path, kRomsDir, strlen(kRomsDir))) {
+		strcpy(emu_name, rom_path + strlen(kRomsDir));
+		char* slash = strchr(emu_name, '/');
+		if (slash) *slash = '\0';
+	}
+	else strcpy(emu_name, "Other");
+
+	char base_name[256];
+	char* name = strrchr(rom_path, '/');
+	strcpy(base_name, name ? name+1 : rom_path);
+	base_name[strlen(base_name)-4] = '\0'; // .zip
+
+	char entry_path[512];
+	char source_path[768];
+	char launch_name[256];
+	char launch_path[768];
+	snprintf(entry_path, sizeof(entry_path), "%s/%s/%s", kCacheDir, emu_name, base_name);
+	snprintf(source_path, sizeof(source_path), "%s/%s", entry_path, kSourceName);
+
+	if (readSource(source_path, &archive, launch_name)) {
+		snprintf(launch_path, sizeof(launch_path), "%s/%s", entry_path, launch_name);
+		if (exists(launch_path)) {
+			utime(entry_path, NULL); // most recently used
+			Timeline_mark("romcache", "hit");
+			puts(launch_path);
+			return 0;
+		}
+	}
+	removeEntry(entry_path); // stale or partial
+
+	Timeline_mark("romcache", "extract");
+	mkdirs(kCacheDir);
+	Zip zip;
+	int ok = Zip_open(&zip, rom_path) && zip.count && makeRoom(zip.total_size);
+	if (ok) ok = extract(&zip, entry_path, base_name, launch_name);
+	Zip_close(&zip);
+
+	if (!ok) {
+		removeEntry(entry_path);
+		fprintf(stderr, "romcache: unable to extract %s\n", rom_path);
+		puts(rom_path);
+		return 0;
+	}
+
+	writeSource(source_path, &archive, launch_name);
+	Timeline_mark("romcache", "extracted");
+	snprintf(launch_path, sizeof(launch_path), "%s/%s", entry_path, launch_name);
+	puts(launch_path);
+	return 0;
+}
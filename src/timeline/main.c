@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timeline.h"
+
+///////////////////////////////////////
+
+// every step of a launch and return, in the order they happen
+static char* kSteps[] = {
+	"press", // MinUI: A or X pressed on a rom or pak
+	"queue_next", // MinUI: next.sh written
+	"minui_exit", // MinUI: about to return from main()
+	"minui_exited", // System.pak: ./MinUI returned
+	"minui_sync", // System.pak: sync after MinUI returned (builds before the state store)
+	"eval", // System.pak: about to eval next.sh
+	"exec", // pak: about to exec the emulator
+	"exit", // pak: emulator exited
+	"eval_done", // System.pak: eval returned
+	"game_sync", // System.pak: sync after the game
+	"main", // MinUI: main() entered
+	"first_flip", // MinUI: first frame presented
+};
+#define kStepCount (sizeof(kSteps)/sizeof(kSteps[0]))
+
+static int Step_index(char* name) {
+	for (int i=0; i<kStepCount; i++) {
+		if (!strcmp(kSteps[i], name)) return i;
+	}
+	return -1;
+}
+
+typedef struct Stat {
+	int count;
+	double sum;
+	double min;
+	double max;
+} Stat;
+static void Stat_add(Stat* self, double ms) {
+	if (!self->count || ms<self->min) self->min = ms;
+	if (!self->count || ms>self->max) self->max = ms;
+	self->sum += ms;
+	self->count += 1;
+}
+
+#define kMaxConsoles 64
+typedef struct Console {
+	char name[256];
+	int launches;
+	Stat steps[kStepCount]; // time from the previous present step to this one
+	Stat launch; // press -> exec
+	Stat back; // exit -> first_flip
+} Console;
+
+static Console consoles[kMaxConsoles];
+static int console_count = 0;
+
+static Console* Console_get(char* name) {
+	for (int i=0; i<console_count; i++) {
+		if (!strcmp(consoles[i].name, name)) return &consoles[i];
+	}
+	if (console_count==kMaxConsoles) return NULL;
+	Console* self = &consoles[console_count++];
+	memset(self, 0, sizeof(Console));
+	snprintf(self->name, sizeof(self->name), "%s", name);
+	return self;
+}
+
+///////////////////////////////////////
+
+static void commit(int64_t* marks, char* console) {
+	if (!console[0]) return;
+	Console* self = Console_get(console);
+	if (!self) return;
+
+	self->launches += 1;
+	int prior = -1;
+	for (int i=0; i<kStepCount; i++) {
+		if (!marks[i]) continue;
+		if (prior>=0) Stat_add(&self->steps[i], (marks[i] - marks[prior]) / 1000.0);
+		prior = i;
+	}
+
+	int press = Step_index("press");
+	int exec = Step_index("exec");
+	int exit = Step_index("exit");
+	int first_flip = Step_index("first_flip");
+	if (marks[press] && marks[exec]) Stat_add(&self->launch, (marks[exec] - marks[press]) / 1000.0);
+	if (marks[exit] && marks[first_flip]) Stat_add(&self->back, (marks[first_flip] - marks[exit]) / 1000.0);
+}
+
+static int summary(char* path) {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		printf("no trace at %s, touch /mnt/SDCARD/.minui/enable-timeline and reboot\n", path);
+		return 1;
+	}
+
+	// a cycle runs from one press to the next first_flip
+	int64_t marks[kStepCount];
+	char console[256];
+	int in_cycle = 0;
+
+	char line[512];
+	while (fgets(line, sizeof(line), file)) {
+		long long at;
+		char event[64];
+		char detail[256];
+		detail[0] = '\0';
+		if (sscanf(line, "%lld %63s %255[^\n]", &at, event, detail)<2) continue;
+
+		int step = Step_index(event);
+		if (step<0) continue;
+
+		if (step==0) { // press starts a new cycle, abandoning any incomplete one
+			memset(marks, 0, sizeof(marks));
+			console[0] = '\0';
+			in_cycle = 1;
+		}
+		if (!in_cycle) continue;
+
+		if (!marks[step]) marks[step] = at;
+		if (!strcmp(event, "queue_next")) strcpy(console, detail);
+
+		if (!strcmp(event, "first_flip")) {
+			commit(marks, console);
+			in_cycle = 0;
+		}
+	}
+	fclose(file);
+
+	if (!console_count) {
+		puts("no complete launches in trace");
+		return 0;
+	}
+
+	for (int i=0; i<console_count; i++) {
+		Console* self = &consoles[i];
+		printf("%s (%i launch%s)\n", self->name, self->launches, self->launches==1?"":"es");
+		printf("  %-28s %9s %9s %9s (ms)\n", "step", "avg", "min", "max");
+		int prior = -1;
+		for (int j=0; j<kStepCount; j++) {
+			Stat* stat = &self->steps[j];
+			if (stat->count) {
+				char label[64];
+				sprintf(label, "%s -> %s", prior>=0 ? kSteps[prior] : "?", kSteps[j]);
+				printf("  %-28s %9.1f %9.1f %9.1f\n", label, stat->sum / stat->count, stat->min, stat->max);
+			}
+			if (stat->count || j==0) prior = j;
+		}
+		if (self->launch.count) printf("  %-28s %9.1f %9.1f %9.1f\n", "launch (press -> exec)", self->launch.sum / self->launch.count, self->launch.min, self->launch.max);
+		if (self->back.count) printf("  %-28s %9.1f %9.1f %9.1f\n", "return (exit -> first_flip)", self->back.sum / self->back.count, self->back.min, self->back.max);
+		puts("");
+	}
+	return 0;
+}
+
+///////////////////////////////////////
+
+int main(int argc, char* argv[]) {
+	if (argc>=3 && !strcmp(argv[1], "mark")) {
+		Timeline_mark(argv[2], argc>3 ? argv[3] : NULL);
+		return 0;
+	}
+	if (argc>=2 && !strcmp(argv[1], "summary")) {
+		return summary(argc>2 ? argv[2] : TIMELINE_PATH);
+	}
+
+	puts("Usage: timeline mark event [detail]");
+	puts("       timeline summary [trace]");
+	return 0;
+}
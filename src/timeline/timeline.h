@@ -0,0 +1,41 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+// timeline.h
+// appends monotonic timestamps to a tmpfs trace so a launch (and return) can be reconstructed
+// tracing is on only while TIMELINE_PATH exists, System.pak/launch.sh creates it when
+// .minui/enable-timeline is present
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#define TIMELINE_PATH "/tmp/timeline.txt"
+
+static inline int64_t Timeline_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+// at is in CLOCK_MONOTONIC microseconds, pass 0 for now
+static inline void Timeline_markAt(char* event, char* detail, int64_t at) {
+	int fd = open(TIMELINE_PATH, O_WRONLY|O_APPEND); // no O_CREAT, missing means disabled
+	if (fd<0) return;
+	
+	char line[512];
+	int len = snprintf(line, sizeof(line), "%lld %s %s\n", (long long)(at ? at : Timeline_now()), event, detail ? detail : "-");
+	if (len>=(int)sizeof(line)) {
+		len = sizeof(line)-1;
+		line[len-1] = '\n';
+	}
+	write(fd, line, len); // a single O_APPEND write so concurrent marks don't interleave
+	close(fd);
+}
+static inline void Timeline_mark(char* event, char* detail) {
+	Timeline_markAt(event, detail, 0);
+}
+
+#endif